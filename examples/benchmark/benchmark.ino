@@ -0,0 +1,104 @@
+// Measures the cost of the parsers on the device.
+// No controller is needed, recorded reports are decoded in a loop.
+#include <GamepadControllerESP32.hpp>
+
+using namespace GamepadControllerESP32;
+
+static const size_t countRepeat = 2000;
+
+static const size_t xboxLen = XboxControllerNotificationParser::expectedDataLen;
+static const size_t newgameLen =
+    NewgameControllerNotificationParser::expectedDataLen;
+
+// idle, sticks moving, buttons and dpad pressed, triggers pulled
+static uint8_t xboxReports[][xboxLen] = {
+    {0xff, 0x7f, 0xff, 0x7f, 0xff, 0x7f, 0xff, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0x12, 0x34, 0xf0, 0x9a, 0x00, 0x80, 0x55, 0x66, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0xff, 0x7f, 0xff, 0x7f, 0xff, 0x7f, 0xff, 0x7f,
+     0, 0, 0, 0, 3, 0x19, 0x18, 1},
+    {0x00, 0x00, 0xff, 0xff, 0x40, 0x20, 0x10, 0x08,
+     0xff, 0x03, 0x80, 0x01, 8, 0xdb, 0x7c, 0},
+};
+static uint8_t newgameReports[][newgameLen] = {
+    {0x40, 0x40, 0x40, 0x40, 0x0f, 0, 0, 0, 0},
+    {0x00, 0x80, 0x12, 0x70, 0x0f, 0, 0, 0x20, 0x30},
+    {0x40, 0x40, 0x40, 0x40, 2, 0xdb, 0x0b, 0, 0},
+    {0x10, 0x20, 0x30, 0x40, 7, 0x01, 0x08, 0xff, 0xff},
+};
+
+static void printResult(const char* name, uint32_t cycles, size_t count) {
+  uint32_t cyclesPerReport = cycles / count;
+  Serial.printf("%-24s %6lu cycles/report %6lu ns/report\n", name,
+                (unsigned long)cyclesPerReport,
+                (unsigned long)(cyclesPerReport * 1000 / ESP.getCpuFreqMHz()));
+}
+
+template <size_t Len, size_t Count>
+static void benchmark(const char* name,
+                      GamepadControllerNotificationParser& parser,
+                      uint8_t (&reports)[Count][Len]) {
+  uint8_t arr[Len];
+  String str;
+  const size_t count = countRepeat * Count;
+  char label[32];
+
+  uint32_t startedAt = ESP.getCycleCount();
+  for (size_t i = 0; i < count; ++i) {
+    parser.update(reports[i % Count], Len);
+  }
+  snprintf(label, sizeof(label), "%s update", name);
+  printResult(label, ESP.getCycleCount() - startedAt, count);
+
+  startedAt = ESP.getCycleCount();
+  for (size_t i = 0; i < count; ++i) {
+    parser.toArr(arr, Len);
+  }
+  snprintf(label, sizeof(label), "%s toArr", name);
+  printResult(label, ESP.getCycleCount() - startedAt, count);
+
+  startedAt = ESP.getCycleCount();
+  for (size_t i = 0; i < count; ++i) {
+    parser.update(reports[i % Count], Len);
+    parser.toArr(arr, Len);
+  }
+  snprintf(label, sizeof(label), "%s round trip", name);
+  printResult(label, ESP.getCycleCount() - startedAt, count);
+
+  // formatting is slow, measure fewer reports
+  const size_t countString = count / 10;
+  startedAt = ESP.getCycleCount();
+  for (size_t i = 0; i < countString; ++i) {
+    str = parser.toString();
+  }
+  snprintf(label, sizeof(label), "%s toString", name);
+  printResult(label, ESP.getCycleCount() - startedAt, countString);
+
+  char buf[gamepadStateFormatMaxLen];
+  startedAt = ESP.getCycleCount();
+  for (size_t i = 0; i < countString; ++i) {
+    parser.format(buf, sizeof(buf));
+  }
+  snprintf(label, sizeof(label), "%s format", name);
+  printResult(label, ESP.getCycleCount() - startedAt, countString);
+
+  startedAt = ESP.getCycleCount();
+  for (size_t i = 0; i < count; ++i) {
+    formatGamepadStateHex(parser.state, buf, sizeof(buf));
+  }
+  snprintf(label, sizeof(label), "%s format hex", name);
+  printResult(label, ESP.getCycleCount() - startedAt, count);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+}
+
+void loop() {
+  XboxControllerNotificationParser xboxParser;
+  NewgameControllerNotificationParser newgameParser;
+  benchmark("xbox", xboxParser, xboxReports);
+  benchmark("newgame", newgameParser, newgameReports);
+  Serial.println("");
+  delay(5000);
+}
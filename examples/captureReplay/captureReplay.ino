@@ -0,0 +1,61 @@
+#include <GamepadControllerESP32.hpp>
+#include <SPIFFS.h>
+
+using namespace GamepadControllerESP32;
+
+// Records 10 seconds of notifications to SPIFFS, then replays them
+BasicGamepadController<XboxControllerNotificationParser> gamepadController;
+
+static const char* capturePath = "/capture.bin";
+static const unsigned long captureMs = 10000;
+File captureFile;
+unsigned long captureStartedAt = 0;
+
+void replay() {
+  File file = SPIFFS.open(capturePath, "r");
+  size_t len = file.size();
+  uint8_t* capture = (uint8_t*)malloc(len);
+  file.read(capture, len);
+  file.close();
+
+  XboxControllerNotificationParser parser;
+  ReportReplay replay;
+  if (!replay.begin(capture, len)) {
+    Serial.println("not a capture");
+    free(capture);
+    return;
+  }
+  // at the captured pace
+  unsigned long startedAt = micros();
+  while (!replay.isFinished()) {
+    if (replay.feedDue(parser, micros() - startedAt) > 0) {
+      parser.printTo(Serial);
+    }
+  }
+  Serial.println("replayed " + String(replay.getCountFed()) + " reports, " +
+                 String(replay.getCountError()) + " errors");
+  free(capture);
+}
+
+void setup() {
+  Serial.begin(115200);
+  SPIFFS.begin(true);
+  gamepadController.begin();
+}
+
+void loop() {
+  gamepadController.onLoop();
+  if (captureStartedAt == 0 && gamepadController.isConnected()) {
+    captureFile = SPIFFS.open(capturePath, "w");
+    gamepadController.startCapture(captureFile);
+    captureStartedAt = millis();
+    Serial.println("capturing");
+  } else if (captureStartedAt != 0 && captureFile &&
+             millis() - captureStartedAt > captureMs) {
+    // writes the queued notifications before the file is closed
+    gamepadController.stopCapture();
+    captureFile.close();
+    replay();
+  }
+  delay(10);
+}
@@ -0,0 +1,30 @@
+#include <GamepadControllerESP32.hpp>
+
+using namespace GamepadControllerESP32;
+
+// Any BLE gamepad, decoded from the HID Report Map read at connection.
+// Required to replace with your controller address because the scan only
+// picks xbox controllers by itself.
+GamepadController gamepadController(
+    "44:16:22:5e:b2:d4", new GenericControllerNotificationParser());
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Starting NimBLE Client");
+  gamepadController.begin();
+}
+
+void loop() {
+  gamepadController.onLoop();
+  if (gamepadController.isConnected()) {
+    if (gamepadController.isWaitingForFirstNotification()) {
+      Serial.println("waiting for first notification");
+    } else {
+      Serial.println("Address: " + gamepadController.buildDeviceAddressStr());
+      gamepadController.gamepadNotif->printTo(Serial);
+    }
+  } else {
+    Serial.println("not connected");
+  }
+  delay(500);
+}
@@ -0,0 +1,40 @@
+#include <GamepadControllerESP32.hpp>
+
+using namespace GamepadControllerESP32;
+
+// any xbox controller, parser embedded at build time
+BasicGamepadController<XboxControllerNotificationParser> gamepadController;
+
+// ramp up the center motor, beat twice, then rumble both sides
+static const HapticKeyframe keyframes[] = {
+    {0, {0, 0, 0, 10}, HapticShape::Ramp, 0, 0},
+    {500, {0, 0, 0, 80}, HapticShape::Pulse, 10, 30},
+    {1300, {0, 0, 0, 0}, HapticShape::Step, 0, 0},
+    {1800, {40, 40, 0, 0}, HapticShape::Step, 0, 0},
+    {2800, {0, 0, 0, 0}, HapticShape::Step, 0, 0},
+};
+static const HapticEffect effect = {keyframes,
+                                    sizeof(keyframes) / sizeof(keyframes[0])};
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Starting NimBLE Client");
+  gamepadController.begin();
+}
+
+void loop() {
+  gamepadController.onLoop();
+  if (gamepadController.isConnected() &&
+      !gamepadController.isWaitingForFirstNotification()) {
+    ButtonEdges edges = gamepadController.consumeButtonEdges();
+    if (edges.isPressed(GamepadButton::A)) {
+      Serial.println("play effect");
+      gamepadController.playHapticEffect(effect);
+    }
+    if (edges.isPressed(GamepadButton::B)) {
+      Serial.println("stop effect");
+      gamepadController.stopHapticEffect();
+    }
+  }
+  delay(10);
+}
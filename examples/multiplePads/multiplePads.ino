@@ -0,0 +1,49 @@
+#include <GamepadControllerESP32.hpp>
+
+using namespace GamepadControllerESP32;
+
+// up to two xbox controllers, scanned and connected by one hub
+BasicGamepadHub<XboxControllerNotificationParser, 2> hub;
+
+// Optionally connect only to these addresses, or to controllers of OUIs
+// (first 3 bytes)
+static const GamepadAddressRule addressRules[] = {
+    {{0x44, 0x16, 0x22, 0x5e, 0xb2, 0xd4}, false},
+    {{0x0c, 0x35, 0x26, 0, 0, 0}, true},
+};
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Starting NimBLE Client");
+  // hub.setAddressRules(addressRules, 2);
+  hub.begin();
+}
+
+void loop() {
+  hub.onLoop();
+  for (size_t i = 0; i < hub.countPad; ++i) {
+    auto& pad = hub.getPad(i);
+    Serial.print("pad " + String(i) + ": ");
+    GamepadState state;
+    if (!pad.isConnected()) {
+      Serial.println("not connected");
+    } else if (pad.isWaitingForFirstNotification() ||
+               !pad.getSnapshot(state)) {
+      Serial.println("waiting for first notification");
+    } else {
+      char buf[gamepadStateFormatMaxLen];
+      formatGamepadStateText(state, buf, sizeof(buf));
+      Serial.print(pad.buildDeviceAddressStr() + " ");
+      Serial.println(buf);
+      if (pad.consumeButtonEdges().isPressed(GamepadButton::A)) {
+        XboxHIDReportBuilder::XboxReportBase repo;
+        repo.setAllOff();
+        repo.v.select.center = true;
+        repo.v.power.center = 50;
+        repo.v.timeActive = 20;
+        pad.scheduleHIDReport(repo);
+      }
+    }
+  }
+  delay(100);
+}
@@ -0,0 +1,46 @@
+#include <GamepadControllerESP32.hpp>
+
+using namespace GamepadControllerESP32;
+
+// Forwards the controller state to another board on Serial1, sending only
+// the fields that changed and a keyframe every 32 frames, in frames with a
+// CRC delimited by 0.
+// The receiving board decodes the bytes with StateTelemetryDecoder.
+GamepadController gamepadController;
+StateTelemetryEncoder encoder(32);
+uint32_t lastSnapshotCount = 0;
+
+void setup() {
+  Serial.begin(115200);
+  Serial1.begin(921600);
+  gamepadController.begin();
+}
+
+void loop() {
+  gamepadController.onLoop();
+  GamepadState state;
+  uint32_t count = gamepadController.getSnapshotCount();
+  if (count != lastSnapshotCount && gamepadController.getSnapshot(state)) {
+    lastSnapshotCount = count;
+    uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+    size_t len = encoder.encode(state, frame);
+    if (len > 0) {
+      Serial1.write(frame, len);
+    }
+  }
+  delay(1);
+}
+
+// On the receiving board, frames are found again after lost or corrupted
+// bytes:
+//
+// StateTelemetryDecoder decoder;
+//
+// void loop() {
+//   GamepadState state;
+//   while (Serial1.available()) {
+//     if (decoder.receive(Serial1.read(), state)) {
+//       // use state
+//     }
+//   }
+// }
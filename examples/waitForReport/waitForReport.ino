@@ -0,0 +1,38 @@
+#include <GamepadControllerESP32.hpp>
+
+using namespace GamepadControllerESP32;
+
+// any xbox controller
+GamepadController gamepadController;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Starting NimBLE Client");
+  gamepadController.begin();
+}
+
+void loop() {
+  gamepadController.onLoop();
+  if (!gamepadController.isConnected()) {
+    delay(100);
+    return;
+  }
+  // sleep until the controller sends a report instead of polling
+  if (!gamepadController.waitForReport(100)) {
+    return;
+  }
+  GamepadState state;
+  if (gamepadController.getSnapshot(state)) {
+    Serial.print("joyLHori: ");
+    Serial.print(state.getAxis(GamepadAxis::LHori));
+    Serial.print(" joyLVert: ");
+    Serial.println(state.getAxis(GamepadAxis::LVert));
+  }
+  ButtonEdges edges = gamepadController.consumeButtonEdges();
+  if (edges.isPressed(GamepadButton::A)) {
+    Serial.println("A pressed");
+  }
+  if (edges.isReleased(GamepadButton::A)) {
+    Serial.println("A released");
+  }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace GamepadControllerESP32 {
+
+// Address in the printed order ("44:16:22:..." is {0x44, 0x16, 0x22, ...}).
+// Only the first 3 bytes are compared when isOui is true, and the
+// advertisement also has to look like a controller then.
+struct GamepadAddressRule {
+  uint8_t bytes[6];
+  bool isOui;
+};
+
+static const uint8_t adTypeUuid16Incomplete = 0x02;
+static const uint8_t adTypeUuid16Complete = 0x03;
+static const uint8_t adTypeAppearance = 0x19;
+static const uint8_t adTypeManufacturerData = 0xff;
+
+static const uint16_t controllerAppearance = 964;
+static const uint16_t controllerUuidServiceHid = 0x1812;
+static const uint8_t controllerManufacturerDataNormal[] = {0x06, 0x00, 0x00};
+static const uint8_t controllerManufacturerDataSearching[] = {0x06, 0x00, 0x03,
+                                                              0x00, 0x80};
+
+// Matches raw advertisement payloads in place, without allocation.
+// The target address and full address rules match by address only.
+// Other advertisements have to be the ones of xbox controllers: gamepad
+// appearance, HID service and known manufacturer data, and come from one of
+// the OUI rules when there are some.
+class AdvertisementFilter {
+ public:
+  // 6 bytes in the order of NimBLEAddress::getNative()
+  void setTargetAddress(const uint8_t* nativeAddress) {
+    memcpy(targetAddress, nativeAddress, sizeof(targetAddress));
+    hasTargetAddress = true;
+  }
+
+  // The rules have to stay alive, a static const array is expected
+  void setAddressRules(const GamepadAddressRule* rules, uint8_t countRule) {
+    this->rules = rules;
+    this->countRule = countRule;
+    countOuiRule = 0;
+    for (uint8_t i = 0; i < countRule; ++i) {
+      if (rules[i].isOui) {
+        ++countOuiRule;
+      }
+    }
+  }
+
+  bool isTarget(const uint8_t* nativeAddress, const uint8_t* payload,
+                size_t length) {
+    ++countSeen;
+    bool result;
+    if (matchesFullAddress(nativeAddress)) {
+      result = true;
+    } else if (countOuiRule != 0) {
+      result = matchesOui(nativeAddress) && matchesController(payload, length);
+    } else {
+      // only the given addresses when set
+      result = !hasTargetAddress && countRule == 0 &&
+               matchesController(payload, length);
+    }
+    if (!result) {
+      ++countRejected;
+    }
+    return result;
+  }
+
+  uint32_t getCountSeen() const { return countSeen; }
+  uint32_t getCountRejected() const { return countRejected; }
+
+ private:
+  uint8_t targetAddress[6];
+  bool hasTargetAddress = false;
+  const GamepadAddressRule* rules = nullptr;
+  uint8_t countRule = 0;
+  uint8_t countOuiRule = 0;
+  uint32_t countSeen = 0;
+  uint32_t countRejected = 0;
+
+  bool matchesFullAddress(const uint8_t* nativeAddress) const {
+    if (hasTargetAddress && memcmp(nativeAddress, targetAddress, 6) == 0) {
+      return true;
+    }
+    for (uint8_t i = 0; i < countRule; ++i) {
+      if (!rules[i].isOui && matchesRule(rules[i], nativeAddress, 6)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool matchesOui(const uint8_t* nativeAddress) const {
+    for (uint8_t i = 0; i < countRule; ++i) {
+      if (rules[i].isOui && matchesRule(rules[i], nativeAddress, 3)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool matchesRule(const GamepadAddressRule& rule,
+                          const uint8_t* nativeAddress, uint8_t countByte) {
+    uint8_t k = 0;
+    while (k < countByte && rule.bytes[k] == nativeAddress[5 - k]) ++k;
+    return k == countByte;
+  }
+
+  static bool matchesController(const uint8_t* payload, size_t length) {
+    uint16_t appearance = 0;
+    bool hasServiceHid = false;
+    const uint8_t* manufacturerData = nullptr;
+    uint8_t manufacturerDataLen = 0;
+    size_t i = 0;
+    while (i + 1 < length) {
+      uint8_t fieldLen = payload[i];
+      if (fieldLen == 0 || i + 1 + fieldLen > length) {
+        break;
+      }
+      uint8_t type = payload[i + 1];
+      const uint8_t* data = &payload[i + 2];
+      uint8_t dataLen = fieldLen - 1;
+      if (type == adTypeAppearance && dataLen >= 2) {
+        appearance = data[0] | (data[1] << 8);
+      } else if (type == adTypeManufacturerData) {
+        manufacturerData = data;
+        manufacturerDataLen = dataLen;
+      } else if (type == adTypeUuid16Incomplete ||
+                 type == adTypeUuid16Complete) {
+        for (uint8_t k = 0; k + 1 < dataLen; k += 2) {
+          if ((data[k] | (data[k + 1] << 8)) == controllerUuidServiceHid) {
+            hasServiceHid = true;
+          }
+        }
+      }
+      i += 1 + fieldLen;
+    }
+    return appearance == controllerAppearance && hasServiceHid &&
+           (isEqual(manufacturerData, manufacturerDataLen,
+                    controllerManufacturerDataNormal,
+                    sizeof(controllerManufacturerDataNormal)) ||
+            isEqual(manufacturerData, manufacturerDataLen,
+                    controllerManufacturerDataSearching,
+                    sizeof(controllerManufacturerDataSearching)));
+  }
+
+  static bool isEqual(const uint8_t* data, size_t len,
+                      const uint8_t* expected, size_t expectedLen) {
+    return data != nullptr && len == expectedLen &&
+           memcmp(data, expected, len) == 0;
+  }
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "GamepadState.h"
+
+namespace GamepadControllerESP32 {
+
+static const int16_t q15One = 32767;
+
+// GamepadState with axes in Q15, the same for every parser:
+// sticks from -q15One (raw minimum) to q15One (raw maximum), 0 at the center,
+// triggers from 0 to q15One.
+struct NormalizedGamepadState {
+  uint32_t buttons;
+  int16_t axes[GamepadAxis::Count];
+};
+
+namespace DeadzoneMode {
+enum : uint8_t {
+  // each axis of a stick on its own, keeps pure horizontal moves
+  Axial = 0,
+  // distance from the center, keeps the direction of diagonal moves
+  Radial,
+};
+};  // namespace DeadzoneMode
+
+// Converts raw axes to Q15 with integer math only: center calibration,
+// deadzone rescaled so the output starts from 0 at its edge, then a response
+// curve of curvePoints points linearly interpolated.
+class AxisNormalizer {
+ public:
+  static const uint8_t curvePoints = 17;  // every 2048 from 0 to 32768
+  static const uint8_t countStickAxis = 4;
+
+  AxisNormalizer() {
+    setStickDeadzone(0);
+    setTriggerDeadzone(0);
+  }
+
+  // Logical maximums of the parser, 0 for axes the controller does not have.
+  // Centers go back to the middle only when the stick range changes.
+  void setRange(uint16_t maxJoy, uint16_t maxTrig) {
+    if (maxTrig != this->maxTrig) {
+      this->maxTrig = maxTrig;
+      trigScale = toScale(maxTrig);
+    }
+    if (maxJoy == this->maxJoy) {
+      return;
+    }
+    this->maxJoy = maxJoy;
+    resetCenters();
+  }
+  // Centers in the middle of the range
+  void resetCenters() {
+    for (uint8_t i = 0; i < countStickAxis; ++i) {
+      setCenter(i, maxJoy / 2);
+    }
+  }
+  bool hasRange() const { return maxJoy != 0 || maxTrig != 0; }
+  uint16_t getMaxJoy() const { return maxJoy; }
+  uint16_t getMaxTrig() const { return maxTrig; }
+
+  // Raw value of a stick axis at rest
+  void setCenter(uint8_t axis, uint16_t rawCenter) {
+    if (axis >= countStickAxis || rawCenter > maxJoy) {
+      return;
+    }
+    centers[axis] = rawCenter;
+    scaleNeg[axis] = toScale(rawCenter);
+    scalePos[axis] = toScale(maxJoy - rawCenter);
+  }
+  uint16_t getCenter(uint8_t axis) const { return centers[axis]; }
+
+  // Takes the sticks of a state at rest as centers
+  void calibrateCenter(const GamepadState& rest) {
+    for (uint8_t i = 0; i < countStickAxis; ++i) {
+      setCenter(i, rest.axes[i]);
+    }
+  }
+
+  // deadzone in Q15, 0 to q15One - 1
+  void setStickDeadzone(uint16_t deadzone,
+                        uint8_t mode = DeadzoneMode::Radial) {
+    stickDeadzone = deadzone < q15One ? deadzone : q15One - 1;
+    stickDeadzoneScale = toScale(q15One - stickDeadzone);
+    stickDeadzoneMode = mode;
+  }
+  void setTriggerDeadzone(uint16_t deadzone) {
+    trigDeadzone = deadzone < q15One ? deadzone : q15One - 1;
+    trigDeadzoneScale = toScale(q15One - trigDeadzone);
+  }
+
+  // curvePoints values from 0 to q15One, nullptr for linear.
+  // The table has to stay alive.
+  void setStickCurve(const uint16_t* curve) { stickCurve = curve; }
+  void setTriggerCurve(const uint16_t* curve) { trigCurve = curve; }
+
+  // Fills curvePoints values of x^exponent, 2 for finer control near the
+  // center. Floating point only runs here, not per report.
+  static void buildPowerCurve(uint16_t* curve, float exponent) {
+    for (uint8_t i = 0; i < curvePoints; ++i) {
+      float x = (float)i / (curvePoints - 1);
+      curve[i] = (uint16_t)(powf(x, exponent) * q15One + 0.5f);
+    }
+  }
+
+  // Axes without range are 0. Returns false while both ranges are unknown.
+  bool normalize(const GamepadState& raw, NormalizedGamepadState& out) const {
+    if (!hasRange()) {
+      return false;
+    }
+    out.buttons = raw.buttons;
+    int32_t sticks[countStickAxis];
+    for (uint8_t i = 0; i < countStickAxis; ++i) {
+      sticks[i] = maxJoy == 0 ? 0 : toQ15(i, raw.axes[i]);
+    }
+    if (stickDeadzoneMode == DeadzoneMode::Radial) {
+      shapeRadial(sticks[GamepadAxis::LHori], sticks[GamepadAxis::LVert]);
+      shapeRadial(sticks[GamepadAxis::RHori], sticks[GamepadAxis::RVert]);
+    } else {
+      for (uint8_t i = 0; i < countStickAxis; ++i) {
+        int32_t magnitude = sticks[i] < 0 ? -sticks[i] : sticks[i];
+        magnitude = shape(magnitude, stickDeadzone, stickDeadzoneScale,
+                          stickCurve);
+        sticks[i] = sticks[i] < 0 ? -magnitude : magnitude;
+      }
+    }
+    for (uint8_t i = 0; i < countStickAxis; ++i) {
+      out.axes[i] = sticks[i];
+    }
+    for (uint8_t i = GamepadAxis::LT; i <= GamepadAxis::RT; ++i) {
+      // trigScale is 0 without triggers
+      uint32_t value = (raw.axes[i] * (uint64_t)trigScale) >> 16;
+      if (value > (uint32_t)q15One) value = q15One;
+      out.axes[i] =
+          shape(value, trigDeadzone, trigDeadzoneScale, trigCurve);
+    }
+    return true;
+  }
+
+ private:
+  uint16_t maxJoy = 0;
+  uint16_t maxTrig = 0;
+  uint16_t centers[countStickAxis] = {};
+  // Q16 factors from raw units to Q15
+  uint32_t scaleNeg[countStickAxis] = {};
+  uint32_t scalePos[countStickAxis] = {};
+  uint32_t trigScale = 0;
+  uint16_t stickDeadzone;
+  uint32_t stickDeadzoneScale;
+  uint8_t stickDeadzoneMode = DeadzoneMode::Radial;
+  uint16_t trigDeadzone;
+  uint32_t trigDeadzoneScale;
+  const uint16_t* stickCurve = nullptr;
+  const uint16_t* trigCurve = nullptr;
+
+  // Q16 factor mapping span to q15One, rounded up so the end reaches it
+  static uint32_t toScale(uint16_t span) {
+    return span == 0 ? 0 : (((uint32_t)q15One << 16) + span - 1) / span;
+  }
+
+  int32_t toQ15(uint8_t axis, uint16_t raw) const {
+    bool isNegative = raw < centers[axis];
+    uint32_t diff = isNegative ? centers[axis] - raw : raw - centers[axis];
+    uint32_t magnitude =
+        (diff * (uint64_t)(isNegative ? scaleNeg[axis] : scalePos[axis])) >>
+        16;
+    if (magnitude > (uint32_t)q15One) magnitude = q15One;
+    return isNegative ? -(int32_t)magnitude : (int32_t)magnitude;
+  }
+
+  // Magnitude 0 to q15One through the deadzone and the curve
+  static int32_t shape(uint32_t magnitude, uint16_t deadzone,
+                       uint32_t deadzoneScale, const uint16_t* curve) {
+    if (magnitude <= deadzone) {
+      return 0;
+    }
+    magnitude = ((magnitude - deadzone) * (uint64_t)deadzoneScale) >> 16;
+    if (magnitude > (uint32_t)q15One) magnitude = q15One;
+    if (curve == nullptr) {
+      return magnitude;
+    }
+    if (magnitude == (uint32_t)q15One) {
+      return curve[curvePoints - 1];
+    }
+    uint8_t index = magnitude >> 11;
+    int32_t frac = magnitude & 0x7ff;
+    int32_t from = curve[index];
+    return from + (((curve[index + 1] - from) * frac) >> 11);
+  }
+
+  void shapeRadial(int32_t& x, int32_t& y) const {
+    uint32_t distance = sqrtInt((uint32_t)(x * x) + (uint32_t)(y * y));
+    if (distance == 0) {
+      return;
+    }
+    // corners of square sticks go back to the circle
+    uint32_t magnitude = distance > (uint32_t)q15One ? q15One : distance;
+    int32_t shaped =
+        shape(magnitude, stickDeadzone, stickDeadzoneScale, stickCurve);
+    x = x * shaped / (int32_t)distance;
+    y = y * shaped / (int32_t)distance;
+  }
+
+  static uint32_t sqrtInt(uint32_t value) {
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+      if (value >= result + bit) {
+        value -= result + bit;
+        result = (result >> 1) + bit;
+      } else {
+        result >>= 1;
+      }
+      bit >>= 2;
+    }
+    return result;
+  }
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace GamepadControllerESP32 {
+
+struct ButtonEdges {
+  uint32_t pressed;
+  uint32_t released;
+
+  bool isPressed(uint32_t button) const { return (pressed & button) != 0; }
+  bool isReleased(uint32_t button) const { return (released & button) != 0; }
+};
+
+// Collects pressed/released bits from every report until they are consumed,
+// so a tap shorter than the consumer's loop period is still seen.
+// update() is called by one task, consume() may be called from another.
+class ButtonEdgeAccumulator {
+ public:
+  void update(uint32_t buttons) {
+    uint32_t changed = buttons ^ lastButtons;
+    if (changed != 0) {
+      pressed.fetch_or(changed & buttons, std::memory_order_relaxed);
+      released.fetch_or(changed & lastButtons, std::memory_order_relaxed);
+      lastButtons = buttons;
+    }
+  }
+
+  ButtonEdges consume() {
+    ButtonEdges edges;
+    edges.pressed = pressed.exchange(0, std::memory_order_relaxed);
+    edges.released = released.exchange(0, std::memory_order_relaxed);
+    return edges;
+  }
+
+  void reset(uint32_t buttons = 0) {
+    lastButtons = buttons;
+    pressed.store(0, std::memory_order_relaxed);
+    released.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  uint32_t lastButtons = 0;
+  std::atomic<uint32_t> pressed{0};
+  std::atomic<uint32_t> released{0};
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "AxisNormalizer.hpp"
+#include "GamepadState.h"
+
+namespace GamepadControllerESP32 {
+
+// Stick centers of one controller, valid for its range only
+struct StickCenters {
+  uint16_t maxJoy;
+  uint16_t centers[AxisNormalizer::countStickAxis];
+
+  void readFrom(const AxisNormalizer& normalizer) {
+    maxJoy = normalizer.getMaxJoy();
+    for (uint8_t i = 0; i < AxisNormalizer::countStickAxis; ++i) {
+      centers[i] = normalizer.getCenter(i);
+    }
+  }
+
+  // Returns false when the centers were taken with another range
+  bool applyTo(AxisNormalizer& normalizer) const {
+    if (maxJoy == 0 || maxJoy != normalizer.getMaxJoy()) {
+      return false;
+    }
+    for (uint8_t i = 0; i < AxisNormalizer::countStickAxis; ++i) {
+      normalizer.setCenter(i, centers[i]);
+    }
+    return true;
+  }
+
+  // Moved by more than 1/256 of the range on an axis
+  bool differsFrom(const StickCenters& other) const {
+    if (maxJoy != other.maxJoy) {
+      return true;
+    }
+    uint16_t threshold = maxJoy / 256;
+    for (uint8_t i = 0; i < AxisNormalizer::countStickAxis; ++i) {
+      uint16_t diff = centers[i] > other.centers[i]
+                          ? centers[i] - other.centers[i]
+                          : other.centers[i] - centers[i];
+      if (diff > threshold) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+// Follows the rest position of the sticks with O(1) work per report.
+// Each axis keeps an exponential mean and variance of its recent values.
+// While both axes of a stick are still and near the center, the center moves
+// slowly towards them. Held sticks are far or moving, so they are ignored.
+class CenterTracker {
+ public:
+  // the mean follows about 8 reports, the center about 128
+  static const uint8_t meanShift = 3;
+  static const uint8_t centerShift = 7;
+
+  // Moves the centers of normalizer, which stays the reference: centers set
+  // there by calibration or a new range restart the tracking.
+  void update(const GamepadState& state, AxisNormalizer& normalizer) {
+    uint16_t maxJoy = normalizer.getMaxJoy();
+    if (maxJoy == 0) {
+      return;
+    }
+    int32_t window = maxJoy / 32 + 1;
+    uint32_t stillness = maxJoy / 512 + 1;
+    // variance with 8 fractional bits like the means
+    uint32_t restVariance = (stillness * stillness) << 8;
+    for (uint8_t stick = 0; stick < AxisNormalizer::countStickAxis;
+         stick += 2) {
+      bool isResting = true;
+      for (uint8_t axis = stick; axis < stick + 2; ++axis) {
+        AxisTrack& track = tracks[axis];
+        uint16_t center = normalizer.getCenter(axis);
+        int32_t value = state.axes[axis];
+        if (!track.isValid || track.appliedCenter != center) {
+          track.isValid = true;
+          track.appliedCenter = center;
+          track.centerQ8 = (int32_t)center << 8;
+          track.meanQ8 = value << 8;
+          track.variance = restVariance << 2;  // still after a few reports
+        }
+        int32_t diff = (value << 8) - track.meanQ8;
+        track.meanQ8 += diff >> meanShift;
+        // 4 fractional bits, larger differences are far from rest anyway
+        uint32_t diffQ4 = (diff < 0 ? -diff : diff) >> 4;
+        if (diffQ4 > 0xffff) diffQ4 = 0xffff;
+        track.variance += ((diffQ4 * diffQ4) >> meanShift) -
+                          (track.variance >> meanShift);
+        int32_t offset = value - center;
+        if (track.variance >= restVariance || offset > window ||
+            offset < -window) {
+          isResting = false;
+        }
+      }
+      if (isResting) {
+        ++countRestingReport;
+        for (uint8_t axis = stick; axis < stick + 2; ++axis) {
+          moveCenter(axis, state.axes[axis], maxJoy, normalizer);
+        }
+      }
+    }
+  }
+
+  // Reports where a stick was taken as resting
+  uint32_t getCountRestingReport() const { return countRestingReport; }
+
+ private:
+  struct AxisTrack {
+    bool isValid;
+    uint16_t appliedCenter;
+    int32_t centerQ8;
+    int32_t meanQ8;
+    uint32_t variance;
+  };
+  AxisTrack tracks[AxisNormalizer::countStickAxis] = {};
+  uint32_t countRestingReport = 0;
+
+  void moveCenter(uint8_t axis, uint16_t value, uint16_t maxJoy,
+                  AxisNormalizer& normalizer) {
+    AxisTrack& track = tracks[axis];
+    track.centerQ8 += (((int32_t)value << 8) - track.centerQ8) >> centerShift;
+    // drift stays within 1/8 of the range from the middle
+    int32_t lowest = (int32_t)(maxJoy / 2 - maxJoy / 8) << 8;
+    int32_t highest = (int32_t)(maxJoy / 2 + maxJoy / 8) << 8;
+    if (track.centerQ8 < lowest) track.centerQ8 = lowest;
+    if (track.centerQ8 > highest) track.centerQ8 = highest;
+    uint16_t center = (track.centerQ8 + 0x80) >> 8;
+    if (center != track.appliedCenter) {
+      normalizer.setCenter(axis, center);
+      track.appliedCenter = center;
+    }
+  }
+};
+
+};  // namespace GamepadControllerESP32
@@ -1,6 +1,23 @@
 #pragma once
 
+#include <Arduino.h>
 #include <NimBLEDevice.h>
+#include <Preferences.h>
+// after Arduino.h, which includes FreeRTOS.h
+#include <freertos/event_groups.h>
+
+#include <AdvertisementFilter.hpp>
+#include <AxisNormalizer.hpp>
+#include <ButtonEdges.hpp>
+#include <CenterTracker.hpp>
+#include <HapticEffectPlayer.hpp>
+#include <NotificationStats.hpp>
+#include <ReportCapture.hpp>
+#include <ReportRing.hpp>
+#include <ReportChangeFilter.hpp>
+#include <RumbleScheduler.hpp>
+#include <SeqlockSnapshot.hpp>
+#include <StateTelemetry.hpp>
 
 #include <Xbox/XboxControllerNotificationParser.h>
 #include <Xbox/XboxHIDReportBuilder.hpp>
@@ -8,59 +25,115 @@
 #include <Newgame/NewgameControllerNotificationParser.h>
 #include <Newgame/NewgameHIDReportBuilder.hpp>
 
+#include <Generic/GenericControllerNotificationParser.h>
+
 // #define GAMEPAD_CONTROLLER_DEBUG_SERIAL Serial
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
 const unsigned long printInterval = 100UL;
 #endif
 
+// Keep every decoded report in a queue for popReport(), power of two
+// #define GAMEPAD_CONTROLLER_REPORT_QUEUE_SIZE 32
+
+// Notifications waiting for onLoop() to write them to a capture, power of two
+#ifndef GAMEPAD_CONTROLLER_CAPTURE_QUEUE_SIZE
+#define GAMEPAD_CONTROLLER_CAPTURE_QUEUE_SIZE 64
+#endif
+
+// Measure notifications for getNotificationStats()
+// #define GAMEPAD_CONTROLLER_STATS
+
+// 2M PHY needs a BLE5 controller
+#if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32S3) || \
+    defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32H2)
+#define GAMEPAD_CONTROLLER_BLE5
+#endif
+
 namespace GamepadControllerESP32 {
 
 static NimBLEUUID uuidServiceGeneral("1801");
 static NimBLEUUID uuidServiceBattery("180f");
 static NimBLEUUID uuidServiceHid("1812");
 static NimBLEUUID uuidCharaReport("2a4d");
+static NimBLEUUID uuidCharaReportMap("2a4b");
 static NimBLEUUID uuidCharaPnp("2a50");
 static NimBLEUUID uuidCharaHidInformation("2a4a");
 static NimBLEUUID uuidCharaPeripheralAppearance("2a01");
 static NimBLEUUID uuidCharaPeripheralControlParameters("2a04");
-
-static NimBLEAdvertisedDevice* advDevice;
-static NimBLEClient* pConnectedClient = nullptr;
-
-static const uint16_t controllerAppearance = 964;
-static const String controllerManufacturerDataNormal = "060000";
-static const String controllerManufacturerDataSearching = "0600030080";
+// report ID and report type of a report characteristic
+static NimBLEUUID uuidDescReportReference("2908");
+static const uint8_t reportTypeOutput = 2;
 
 enum class ConnectionState : uint8_t {
   Connected = 0,
   WaitingForFirstNotification = 1,
   Found = 2,
   Scanning = 3,
+  Connecting = 4,
+  Discovering = 5,
+  Subscribing = 6,
+};
+
+// Connection parameters requested to the controller.
+// Intervals are in 1.25 ms units and the timeout in 10 ms units.
+struct ConnectionProfile {
+  uint16_t minInterval;
+  uint16_t maxInterval;
+  uint16_t latency;
+  uint16_t timeout;
+  bool prefers2MPhy;
+};
+
+namespace ConnectionProfiles {
+// 7.5 ms, the shortest interval of BLE
+static const ConnectionProfile lowLatency = {6, 6, 0, 100, true};
+static const ConnectionProfile balanced = {12, 24, 0, 200, true};
+// the controller may skip 4 intervals when nothing changes
+static const ConnectionProfile lowPower = {24, 48, 4, 400, false};
+};  // namespace ConnectionProfiles
+
+// Parameters in use, PHY is 1 for 1M, 2 for 2M and 3 for coded
+struct ConnectionStatus {
+  uint32_t intervalUs;
+  uint16_t latency;
+  uint16_t timeoutMs;
+  uint8_t txPhy;
+  uint8_t rxPhy;
 };
 
 class ClientCallbacks : public NimBLEClientCallbacks {
  public:
-  ConnectionState* pConnectionState;
-  ClientCallbacks(ConnectionState* pConnectionState) {
+  ConnectionState volatile* pConnectionState;
+  NimBLERemoteCharacteristic** ppCharaOutput;
+#ifdef GAMEPAD_CONTROLLER_STATS
+  uint32_t countDisconnect = 0;
+#endif
+  ClientCallbacks(ConnectionState volatile* pConnectionState,
+                  NimBLERemoteCharacteristic** ppCharaOutput) {
     this->pConnectionState = pConnectionState;
+    this->ppCharaOutput = ppCharaOutput;
   }
 
-  void onConnect(NimBLEClient* pClient) {
+  void onConnect(NimBLEClient* /*pClient*/) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Connected");
 #endif
-    *pConnectionState = ConnectionState::WaitingForFirstNotification;
+    *pConnectionState = ConnectionState::Discovering;
     // pClient->updateConnParams(120,120,0,60);
   };
 
   void onDisconnect(NimBLEClient* pClient) {
+    (void)pClient;
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.print(
         pClient->getPeerAddress().toString().c_str());
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(" Disconnected");
+#endif
+#ifdef GAMEPAD_CONTROLLER_STATS
+    ++countDisconnect;
 #endif
     *pConnectionState = ConnectionState::Scanning;
-    pConnectedClient = nullptr;
+    *ppCharaOutput = nullptr;
   };
 
   /********************* Security handled here **********************
@@ -74,6 +147,7 @@ class ClientCallbacks : public NimBLEClientCallbacks {
   };
 
   bool onConfirmPIN(uint32_t pass_key) {
+    (void)pass_key;
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.print("The passkey YES/NO number: ");
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(pass_key);
@@ -84,6 +158,7 @@ class ClientCallbacks : public NimBLEClientCallbacks {
 
   /** Pairing process complete, we can check the results in ble_gap_conn_desc */
   void onAuthenticationComplete(ble_gap_conn_desc* desc) {
+    (void)desc;
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("onAuthenticationComplete");
     if (!desc->sec_state.encrypted) {
@@ -96,22 +171,17 @@ class ClientCallbacks : public NimBLEClientCallbacks {
   };
 };
 
-/** Define a class to handle the callbacks when advertisments are received */
-class AdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
+/** Decides which advertised devices are controllers to connect */
+class AdvertisedDeviceFilter : public AdvertisementFilter {
  public:
-  AdvertisedDeviceCallbacks(String strTargetDeviceAddress,
-                            ConnectionState* pConnectionState) {
+  AdvertisedDeviceFilter(String strTargetDeviceAddress) {
     if (strTargetDeviceAddress != "") {
-      this->targetDeviceAddress =
-          new NimBLEAddress(strTargetDeviceAddress.c_str());
+      setTargetAddress(
+          NimBLEAddress(strTargetDeviceAddress.c_str()).getNative());
     }
-    this->pConnectionState = pConnectionState;
   }
 
- private:
-  NimBLEAddress* targetDeviceAddress = nullptr;
-  ConnectionState* pConnectionState;
-  void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
+  bool isTarget(NimBLEAdvertisedDevice* advertisedDevice) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.print("Advertised Device found: ");
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(
@@ -125,83 +195,284 @@ class AdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
             ? advertisedDevice->getServiceUUID().toString().c_str()
             : "none");
 #endif
-    char* pHex = NimBLEUtils::buildHexData(
-        nullptr, (uint8_t*)advertisedDevice->getManufacturerData().data(),
-        advertisedDevice->getManufacturerData().length());
-    if ((targetDeviceAddress != nullptr &&
-         advertisedDevice->getAddress().equals(*targetDeviceAddress)) ||
-        (targetDeviceAddress == nullptr &&
-         advertisedDevice->getAppearance() == controllerAppearance &&
-         (strcmp(pHex, controllerManufacturerDataNormal.c_str()) == 0 ||
-          strcmp(pHex, controllerManufacturerDataSearching.c_str()) == 0) &&
-         advertisedDevice->getServiceUUID().equals(uuidServiceHid)))
-    // if (advertisedDevice->isAdvertisingService(uuidServiceHid))
-    {
+    return AdvertisementFilter::isTarget(
+        advertisedDevice->getAddress().getNative(),
+        advertisedDevice->getPayload(), advertisedDevice->getPayloadLength());
+  }
+};
+
+/** Define a class to handle the callbacks when advertisments are received */
+class AdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
+ public:
+  AdvertisedDeviceCallbacks(String strTargetDeviceAddress,
+                            ConnectionState volatile* pConnectionState,
+                            NimBLEAdvertisedDevice** ppAdvDevice)
+      : filter(strTargetDeviceAddress) {
+    this->pConnectionState = pConnectionState;
+    this->ppAdvDevice = ppAdvDevice;
+  }
+
+  AdvertisedDeviceFilter filter;
+
+ private:
+  ConnectionState volatile* pConnectionState;
+  NimBLEAdvertisedDevice** ppAdvDevice;
+  void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
+    if (filter.isTarget(advertisedDevice)) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Found target");
 #endif
       /** stop scan before connecting */
       // NimBLEDevice::getScan()->stop();
-      /** Save the device reference in a global for the client to use*/
+      /** Save the device reference for the controller to connect */
       *pConnectionState = ConnectionState::Found;
-      advDevice = advertisedDevice;
+      *ppAdvDevice = advertisedDevice;
     }
   };
 };
 
-class GamepadController {
+// Address of the last connected controller kept in NVS, so it can be
+// connected without scanning after a reset
+class PeerAddressStore {
  public:
-  GamepadController(String targetDeviceAddress = "",
-    GamepadControllerNotificationParser* parser = new XboxControllerNotificationParser()) 
-    : gamepadNotif(parser) {
-    this->advDeviceCBs =
-        new AdvertisedDeviceCallbacks(targetDeviceAddress, &connectionState);
-    this->clientCBs = new ClientCallbacks(&connectionState);
-    // this->gamepadNotif = new XboxControllerNotificationParser();
+  static const size_t dataLen = 7;  // native address and type
+
+  bool load(uint8_t* nativeAddress, uint8_t& type) {
+    uint8_t data[dataLen];
+    Preferences preferences;
+    preferences.begin(namespaceName, true);
+    size_t len = preferences.getBytes(keyPeer, data, dataLen);
+    preferences.end();
+    if (len != dataLen) {
+      return false;
+    }
+    memcpy(nativeAddress, data, 6);
+    type = data[6];
+    return true;
+  }
+
+  void save(const uint8_t* nativeAddress, uint8_t type) {
+    uint8_t data[dataLen];
+    memcpy(data, nativeAddress, 6);
+    data[6] = type;
+    Preferences preferences;
+    preferences.begin(namespaceName, false);
+    preferences.putBytes(keyPeer, data, dataLen);
+    preferences.end();
+  }
+
+  void clear() {
+    Preferences preferences;
+    preferences.begin(namespaceName, false);
+    preferences.remove(keyPeer);
+    preferences.end();
+  }
+
+ private:
+  static constexpr const char* namespaceName = "gamepadCtrl";
+  static constexpr const char* keyPeer = "peer";
+};
+
+// Stick centers per controller, the key is "c" and the address in hex
+class CenterStore {
+ public:
+  bool load(const uint8_t* nativeAddress, StickCenters& centers) {
+    char key[keyLen];
+    buildKey(nativeAddress, key);
+    Preferences preferences;
+    preferences.begin(namespaceName, true);
+    size_t len = preferences.getBytes(key, &centers, sizeof(StickCenters));
+    preferences.end();
+    return len == sizeof(StickCenters);
+  }
+
+  void save(const uint8_t* nativeAddress, const StickCenters& centers) {
+    char key[keyLen];
+    buildKey(nativeAddress, key);
+    Preferences preferences;
+    preferences.begin(namespaceName, false);
+    preferences.putBytes(key, &centers, sizeof(StickCenters));
+    preferences.end();
+  }
+
+ private:
+  static const size_t keyLen = 14;
+  static constexpr const char* namespaceName = "gamepadCtrl";
+
+  static void buildKey(const uint8_t* nativeAddress, char* key) {
+    key[0] = 'c';
+    for (uint8_t i = 0; i < 6; ++i) {
+      sprintf(&key[1 + i * 2], "%02x", nativeAddress[5 - i]);
+    }
+  }
+};
+
+static void beginGamepadDevice() {
+  NimBLEDevice::setScanFilterMode(CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE);
+  // NimBLEDevice::setScanDuplicateCacheSize(200);
+  NimBLEDevice::init("");
+  NimBLEDevice::setOwnAddrType(BLE_OWN_ADDR_PUBLIC);
+  NimBLEDevice::setSecurityAuth(true, false, false);
+  NimBLEDevice::setPower(ESP_PWR_LVL_P9); /* +9db */
+}
+
+static void scanCompleteCB(NimBLEScanResults /*results*/) {
+#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
+  GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Scan Ended");
+#endif
+}
+
+static void startGamepadScan(NimBLEAdvertisedDeviceCallbacks* pCallbacks,
+                             uint32_t scanTime) {
+  auto pScan = NimBLEDevice::getScan();
+  // pScan->clearResults();
+  // pScan->clearDuplicateCache();
+  pScan->setDuplicateFilter(false);
+  pScan->setAdvertisedDeviceCallbacks(pCallbacks);
+  // pScan->setActiveScan(true);
+  pScan->setInterval(97);
+  pScan->setWindow(97);
+#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
+  GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Start scan");
+#endif
+  // assign scanCompleteCB to scan on other thread
+  pScan->start(scanTime, scanCompleteCB, false);
+}
+
+template <typename Parser, size_t CountPad>
+class BasicGamepadHub;
+
+// Parser embedded in the controller, so its calls are bound at compile time
+template <typename Parser>
+class GamepadParserStorage {
+ public:
+  Parser& get() { return parser; }
+
+ private:
+  Parser parser;
+};
+
+// Parser chosen at run time, xbox one by default
+template <>
+class GamepadParserStorage<GamepadControllerNotificationParser> {
+ public:
+  GamepadParserStorage() : pParser(new XboxControllerNotificationParser()) {}
+  GamepadParserStorage(GamepadControllerNotificationParser* parser)
+      : pParser(parser) {}
+  GamepadControllerNotificationParser& get() { return *pParser; }
+
+ private:
+  GamepadControllerNotificationParser* pParser;
+};
+
+// Use BasicGamepadController<XboxControllerNotificationParser> (or another
+// parser class) when the controller type is known at build time.
+// GamepadController takes a parser object instead.
+template <typename Parser>
+class BasicGamepadController {
+ public:
+  BasicGamepadController(String targetDeviceAddress = "")
+      : advDeviceCBs(targetDeviceAddress, &connectionState, &advDevice),
+        clientCBs(&connectionState, &pCharaOutput),
+        gamepadNotif(&notifStorage.get()) {
+    stateSnapshot.publish(gamepadNotif->state);
+    setTargetAsPeer(targetDeviceAddress);
+  }
+
+  // Only for GamepadController
+  BasicGamepadController(String targetDeviceAddress, Parser* parser)
+      : advDeviceCBs(targetDeviceAddress, &connectionState, &advDevice),
+        clientCBs(&connectionState, &pCharaOutput),
+        notifStorage(parser),
+        gamepadNotif(&notifStorage.get()) {
+    stateSnapshot.publish(gamepadNotif->state);
+    setTargetAsPeer(targetDeviceAddress);
   }
 
-  AdvertisedDeviceCallbacks* advDeviceCBs;
-  ClientCallbacks* clientCBs;
   uint8_t battery = 0;
   static const int deviceAddressLen = 6;
   uint8_t deviceAddressArr[deviceAddressLen];
 
-  GamepadControllerNotificationParser* gamepadNotif;
+ private:
+  template <typename, size_t>
+  friend class BasicGamepadHub;
+
+  ConnectionState volatile connectionState = ConnectionState::Scanning;
+  NimBLEAdvertisedDevice* advDevice = nullptr;
+  // task running connectToServer, owned by the hub for its pads
+  TaskHandle_t connectionTask = nullptr;
+  // Wakes the connection task. NimBLE waits for its events on the task
+  // notification, which another notification would end early.
+  EventGroupHandle_t connectionEvents = nullptr;
+  // bits of the requests, different for each pad of a hub
+  EventBits_t connectionBit = 0x01;
+  EventBits_t centersSaveBit = 0x02;
+  bool volatile isConnectionRequested = false;
+  NimBLEAddress connectingAddress;
+  int connectingRetryCount = 0;
+  bool isConnectingPeer = false;
+  // address to connect without scanning, the target or the last one
+  NimBLEAddress peerAddress;
+  bool hasPeerAddress = false;
+  bool hasTargetAddress = false;
+  bool remembersPeer = true;
+  bool connectsPeerNext = true;
+  // output report of the HID service, resolved in afterConnect
+  NimBLERemoteCharacteristic* pCharaOutput = nullptr;
+  AdvertisedDeviceCallbacks advDeviceCBs;
+  ClientCallbacks clientCBs;
+  GamepadParserStorage<Parser> notifStorage;
+
+ public:
+  Parser* const gamepadNotif;
+
+  static const uint32_t connectionTaskStackSize = 8192;
 
-  void begin() {
-    NimBLEDevice::setScanFilterMode(CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE);
-    // NimBLEDevice::setScanDuplicateCacheSize(200);
-    NimBLEDevice::init("");
-    NimBLEDevice::setOwnAddrType(BLE_OWN_ADDR_PUBLIC);
-    NimBLEDevice::setSecurityAuth(true, false, false);
-    NimBLEDevice::setPower(ESP_PWR_LVL_P9); /* +9db */
+  // Starts the connection task, which connects, discovers and subscribes
+  // while onLoop() keeps returning immediately
+  void begin(UBaseType_t connectionTaskPriority = 1) {
+    beginGamepadDevice();
+    if (connectionTask == nullptr) {
+      connectionEvents = xEventGroupCreate();
+      xTaskCreate(connectionTaskMain, "gamepadConn", connectionTaskStackSize,
+                  this, connectionTaskPriority, &connectionTask);
+    }
+    if (remembersPeer && !hasTargetAddress) {
+      uint8_t address[6];
+      uint8_t type;
+      if (PeerAddressStore().load(address, type)) {
+        peerAddress = NimBLEAddress(address, type);
+        hasPeerAddress = true;
+      }
+    }
+  }
+
+  // Whether the last connected address is kept in NVS (default true).
+  // Call before begin().
+  void setRemembersPeer(bool remembersPeer) {
+    this->remembersPeer = remembersPeer;
+  }
+  void forgetPeer() {
+    if (!hasTargetAddress) {
+      hasPeerAddress = false;
+    }
+    PeerAddressStore().clear();
   }
 
   void writeHIDReport(uint8_t* dataArr, size_t dataLen) {
-    if (pConnectedClient == nullptr) {
+    NimBLERemoteCharacteristic* pChara = pCharaOutput;
+    if (pChara == nullptr) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("no connnected client");
 #endif
       return;
     }
-    NimBLEClient* pClient = pConnectedClient;
-    auto pService = pClient->getService(uuidServiceHid);
-#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
-    GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(pService->toString().c_str());
-#endif
-    for (auto pChara : *pService->getCharacteristics()) {
-      if (pChara->canWrite()) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
-        GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(
-            "canWrite " + String(pChara->canWrite()));
-        GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(
-            pChara->toString().c_str());
-        writeWithComment(pChara, dataArr, dataLen);
+    GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(pChara->toString().c_str());
+    writeWithComment(pChara, dataArr, dataLen);
 #else
-        pChara->writeValue(dataArr, dataLen, false);
+    pChara->writeValue(dataArr, dataLen, false);
 #endif
-      }
-    }
   }
 
   void writeHIDReport(
@@ -225,26 +496,64 @@ class GamepadController {
     writeHIDReport((uint8_t*)repo.arr8t, repo.arr8tLen);
   }
 
-  void onLoop() {
-    if (!isConnected()) {
-      if (advDevice != nullptr) {
-        auto connectionResult = connectToServer(advDevice);
-        if (!connectionResult || !isConnected()) {
-          NimBLEDevice::deleteBond(advDevice->getAddress());
-          ++countFailedConnection;
-          // reset();
-          connectionState = ConnectionState::Scanning;
-        } else {
-          countFailedConnection = 0;
-        }
-        advDevice = nullptr;
-      } else if (!isScanning()) {
-        // reset();
-        startScan();
-      }
-    }
+  void writeHIDReport(const XboxHIDReportBuilder::XboxReportBase& repo) {
+    writeHIDReport((uint8_t*)repo.arr8t, repo.arr8tLen);
   }
 
+  void writeHIDReport(
+      const NewgameHIDReportBuilder::NewgameReportBase& repo) {
+    writeHIDReport((uint8_t*)repo.arr8t, repo.arr8tLen);
+  }
+
+  // Queues a report to be written from onLoop(). Only the newest one is kept
+  // and writes are spaced by setHIDReportIntervalMs().
+  void scheduleHIDReport(const uint8_t* dataArr, size_t dataLen) {
+    rumbleScheduler.submit(dataArr, dataLen);
+  }
+
+  void scheduleHIDReport(const XboxHIDReportBuilder::XboxReportBase& repo) {
+    scheduleHIDReport(repo.arr8t, repo.arr8tLen);
+  }
+
+  void scheduleHIDReport(
+      const NewgameHIDReportBuilder::NewgameReportBase& repo) {
+    scheduleHIDReport(repo.arr8t, repo.arr8tLen);
+  }
+
+  void scheduleHIDReport(
+      const XboxHIDReportBuilder::XboxReportBeforeUnion& repoBeforeUnion) {
+    XboxHIDReportBuilder::XboxReportBase repo;
+    repo.v = repoBeforeUnion;
+    scheduleHIDReport(repo.arr8t, repo.arr8tLen);
+  }
+
+  void scheduleHIDReport(
+      const NewgameHIDReportBuilder::NewgameReportBeforeUnion&
+          repoBeforeUnion) {
+    NewgameHIDReportBuilder::NewgameReportBase repo;
+    repo.v = repoBeforeUnion;
+    scheduleHIDReport(repo.arr8t, repo.arr8tLen);
+  }
+
+  // Plays the effect from onLoop() through scheduleHIDReport().
+  // The effect has to stay alive while playing.
+  // Returns false when the keyframes do not start at 0 ms or do not
+  // strictly increase
+  bool playHapticEffect(const HapticEffect& effect) {
+    return hapticPlayer.start(effect, millis());
+  }
+  void stopHapticEffect() { hapticPlayer.stop(); }
+  bool isPlayingHapticEffect() { return hapticPlayer.isPlaying(); }
+
+  void setHIDReportIntervalMs(unsigned long ms) {
+    rumbleScheduler.setIntervalMs(ms);
+  }
+  const RumbleSchedulerStats& getRumbleStats() {
+    return rumbleScheduler.getStats();
+  }
+
+  void onLoop() { runLoop(true); }
+
   String buildDeviceAddressStr() {
     char buffer[18];
     auto addr = deviceAddressArr;
@@ -255,19 +564,17 @@ class GamepadController {
 
   void startScan() {
     connectionState = ConnectionState::Scanning;
-    auto pScan = NimBLEDevice::getScan();
-    // pScan->clearResults();
-    // pScan->clearDuplicateCache();
-    pScan->setDuplicateFilter(false);
-    pScan->setAdvertisedDeviceCallbacks(advDeviceCBs);
-    // pScan->setActiveScan(true);
-    pScan->setInterval(97);
-    pScan->setWindow(97);
-#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
-    GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Start scan");
-#endif
-    // assign scanCompleteCB to scan on other thread
-    pScan->start(scanTime, &GamepadController::scanCompleteCB, false);
+    startGamepadScan(&advDeviceCBs, scanTime);
+  }
+
+  // Connects only to addresses matching one of the rules. Addresses of OUI
+  // rules also have to advertise like a controller.
+  void setAddressRules(const GamepadAddressRule* rules, uint8_t countRule) {
+    advDeviceCBs.filter.setAddressRules(rules, countRule);
+  }
+  uint32_t getCountAdvertSeen() { return advDeviceCBs.filter.getCountSeen(); }
+  uint32_t getCountAdvertRejected() {
+    return advDeviceCBs.filter.getCountRejected();
   }
 
   bool isWaitingForFirstNotification() {
@@ -277,17 +584,187 @@ class GamepadController {
     return connectionState == ConnectionState::WaitingForFirstNotification ||
            connectionState == ConnectionState::Connected;
   }
+  // Connection, discovery or subscription running in the connection task
+  bool isConnecting() {
+    return connectionState == ConnectionState::Connecting ||
+           connectionState == ConnectionState::Discovering ||
+           connectionState == ConnectionState::Subscribing;
+  }
+  ConnectionState getConnectionState() { return connectionState; }
   unsigned long getReceiveNotificationAt() { return receivedNotificationAt; }
+  // Writes every raw HID notification to out in the ReportCapture format.
+  // Notifications are queued and written from onLoop(), so a slow output
+  // never blocks the BLE host. They are dropped while the queue is full.
+  // Call it and stopCapture() from the task running onLoop(), which is the
+  // only reader of the queue.
+  void startCapture(Print& out) {
+    stopCapture();
+    if (pCaptureQueue == nullptr) {
+      pCaptureQueue = new CaptureQueue();
+    }
+    uint8_t header[sizeof(reportCaptureHeader)];
+    out.write(header, captureWriter.writeHeader(header));
+    pCaptureOutput = &out;
+    isCapturing.store(true);
+  }
+  // Writes the queued notifications, out can be closed once it returns
+  void stopCapture() {
+    if (pCaptureOutput == nullptr) {
+      return;
+    }
+    isCapturing.store(false);
+    // a notification may be pushing
+    while (countCapturePushing.load() != 0) {
+      delay(1);
+    }
+    flushCapture();
+    pCaptureOutput = nullptr;
+  }
+  // Notifications lost because the queue was full or they were too long
+  uint32_t getCountCaptureDropped() {
+    return (pCaptureQueue == nullptr ? 0 : pCaptureQueue->getOverflowCount()) +
+           countCaptureTooLong;
+  }
+
+#ifdef GAMEPAD_CONTROLLER_STATS
+  // Values are updated without locking, see NotificationStats
+  const NotificationStats& getNotificationStats() {
+    stats.countDisconnect = clientCBs.countDisconnect;
+    return stats;
+  }
+  void resetNotificationStats() {
+    stats.reset();
+    clientCBs.countDisconnect = 0;
+  }
+#endif
+  // Consistent copy of the last decoded report, safe to call from any task
+  bool getSnapshot(GamepadState& state) { return stateSnapshot.read(state); }
+  // Q15 axes computed at decode time with the ranges of the parser, see
+  // AxisNormalizer.hpp. Configure getAxisNormalizer() before begin().
+  void setNormalizesAxes(bool normalizesAxes) {
+    this->normalizesAxes = normalizesAxes;
+  }
+  AxisNormalizer& getAxisNormalizer() { return axisNormalizer; }
+  bool getNormalizedSnapshot(NormalizedGamepadState& state) {
+    return normalizedSnapshot.read(state);
+  }
+  // The sticks of the next report become the centers, keep them released
+  void calibrateCenter() { isCenterCalibrationRequested = true; }
+  // Skips the decoding of reports equal to the previous one, and the
+  // dispatch of states within the axis thresholds of getReportChangeFilter().
+  // Snapshots, edges, queue and listener then only see changes.
+  void setSuppressesDuplicates(bool suppressesDuplicates) {
+    this->suppressesDuplicates = suppressesDuplicates;
+  }
+  ReportChangeFilter& getReportChangeFilter() { return changeFilter; }
+  uint32_t getCountSuppressedReport() {
+    return changeFilter.getCountSameRaw() +
+           changeFilter.getCountBelowThreshold();
+  }
+  // Follows the stick centers while the sticks rest and keeps them in NVS
+  // per controller, see CenterTracker.hpp. Also normalizes the axes.
+  void setTracksCenter(bool tracksCenter) {
+    this->tracksCenter = tracksCenter;
+    if (tracksCenter) {
+      normalizesAxes = true;
+    }
+  }
+  uint32_t getSnapshotCount() { return stateSnapshot.getCount(); }
+  // Buttons pressed/released since the previous call
+  ButtonEdges consumeButtonEdges() { return buttonEdges.consume(); }
+  // Task to be notified by xTaskNotifyGive on every decoded report
+  void setReportListenerTask(TaskHandle_t task) { reportListenerTask = task; }
+  // Blocks the calling task until a report is decoded after the previous
+  // call. Uses the task notification of the calling task.
+  bool waitForReport(uint32_t timeoutMs) {
+    reportListenerTask = xTaskGetCurrentTaskHandle();
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) > 0;
+  }
+#ifdef GAMEPAD_CONTROLLER_REPORT_QUEUE_SIZE
+  // Oldest queued report, call from one task only
+  bool popReport(TimedReport& report) { return reportQueue.pop(report); }
+  size_t getCountQueuedReport() { return reportQueue.size(); }
+  uint32_t getCountReportOverflow() { return reportQueue.getOverflowCount(); }
+#endif
   uint8_t getCountFailedConnection() { return countFailedConnection; }
 
+  // Applied at the next connection, and requested now when connected
+  void setConnectionProfile(const ConnectionProfile& profile) {
+    connectionProfile = profile;
+    if (pClient != nullptr && isConnected()) {
+      applyConnectionProfile(pClient);
+    }
+  }
+  const ConnectionProfile& getConnectionProfile() {
+    return connectionProfile;
+  }
+
+  bool getConnectionStatus(ConnectionStatus& status) {
+    if (pClient == nullptr || !isConnected()) {
+      return false;
+    }
+    NimBLEConnInfo info = pClient->getConnInfo();
+    status.intervalUs = (uint32_t)info.getConnInterval() * 1250;
+    status.latency = info.getConnLatency();
+    status.timeoutMs = info.getConnTimeout() * 10;
+    status.txPhy = status.rxPhy = BLE_GAP_LE_PHY_1M;
+#ifdef GAMEPAD_CONTROLLER_BLE5
+    ble_gap_read_le_phy(pClient->getConnId(), &status.txPhy, &status.rxPhy);
+#endif
+    return true;
+  }
+
  private:
-  ConnectionState connectionState = ConnectionState::Scanning;
   unsigned long receivedNotificationAt = 0;
+  typedef ReportRing<GAMEPAD_CONTROLLER_CAPTURE_QUEUE_SIZE, RawReport>
+      CaptureQueue;
+  // used by the task running onLoop() only
+  Print* pCaptureOutput = nullptr;
+  ReportCaptureWriter captureWriter;
+  // allocated by the first capture and kept for the next ones
+  CaptureQueue* pCaptureQueue = nullptr;
+  std::atomic<bool> isCapturing{false};
+  std::atomic<uint8_t> countCapturePushing{0};
+  uint32_t countCaptureTooLong = 0;
+#ifdef GAMEPAD_CONTROLLER_STATS
+  NotificationStats stats;
+#endif
+  SeqlockSnapshot<GamepadState> stateSnapshot;
+  bool suppressesDuplicates = false;
+  ReportChangeFilter changeFilter;
+  bool normalizesAxes = false;
+  volatile bool isCenterCalibrationRequested = false;
+  AxisNormalizer axisNormalizer;
+  SeqlockSnapshot<NormalizedGamepadState> normalizedSnapshot;
+  bool tracksCenter = false;
+  CenterTracker centerTracker;
+  // loaded at connection, applied from the notification callback
+  StickCenters loadedCenters;
+  volatile bool hasLoadedCenters = false;
+  StickCenters savedCenters;
+  // written by the connection task
+  StickCenters pendingCenters;
+  uint8_t pendingCentersAddress[deviceAddressLen];
+  volatile bool isCentersSaveRequested = false;
+  unsigned long centersSavedAt = 0;
+  unsigned long centerSaveIntervalMs = 60000;
+  ButtonEdgeAccumulator buttonEdges;
+  TaskHandle_t volatile reportListenerTask = nullptr;
+#ifdef GAMEPAD_CONTROLLER_REPORT_QUEUE_SIZE
+  ReportRing<GAMEPAD_CONTROLLER_REPORT_QUEUE_SIZE> reportQueue;
+#endif
   uint32_t scanTime = 4; /** 0 = scan forever */
   uint8_t countFailedConnection = 0;
+  // the bond is deleted after this count of failed connections in a row
+  uint8_t countFailedConnectionToUnbond = 3;
+  uint8_t connectTimeoutSec = 3;
+  ConnectionProfile connectionProfile = ConnectionProfiles::lowLatency;
   uint8_t retryCountInOneConnection = 3;
   unsigned long retryIntervalMs = 100;
   NimBLEClient* pClient = nullptr;
+  NimBLERemoteCharacteristic* pCharaBattery = nullptr;
+  RumbleScheduler rumbleScheduler;
+  HapticEffectPlayer hapticPlayer;
 
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
   static void writeWithComment(NimBLERemoteCharacteristic* pChara,
@@ -317,6 +794,172 @@ class GamepadController {
 
   bool isScanning() { return NimBLEDevice::getScan()->isScanning(); }
 
+  // Scanning is left to the hub when canStartScan is false
+  void runLoop(bool canStartScan) {
+    if (hapticPlayer.isPlaying()) {
+      XboxHIDReportBuilder::XboxReportBase repo;
+      if (hapticPlayer.update(millis(), repo)) {
+        scheduleHIDReport(repo);
+      }
+    }
+    flushScheduledHIDReport();
+    if (pCaptureOutput != nullptr) {
+      flushCapture();
+    }
+    if (tracksCenter && isConnected()) {
+      requestMovedCentersSave();
+    }
+    if (isConnected() || isConnecting() || connectionTask == nullptr) {
+      return;
+    }
+    if (advDevice != nullptr) {
+      requestConnection(advDevice->getAddress(), retryCountInOneConnection,
+                        false);
+      advDevice = nullptr;
+    } else if (canStartScan && !isScanning()) {
+      // try the known address and scanning in turn
+      if (hasPeerAddress && connectsPeerNext) {
+        connectsPeerNext = false;
+        // no retry because the controller may be off
+        requestConnection(peerAddress, 0, true);
+      } else {
+        connectsPeerNext = true;
+        // reset();
+        startScan();
+      }
+    }
+  }
+
+  void requestConnection(const NimBLEAddress& address, int retryCount,
+                         bool isPeer) {
+    connectingAddress = address;
+    connectingRetryCount = retryCount;
+    isConnectingPeer = isPeer;
+    connectionState = ConnectionState::Connecting;
+    isConnectionRequested = true;
+    xEventGroupSetBits(connectionEvents, connectionBit);
+  }
+
+  // Called from the connection task with the bits it was woken by
+  void runRequests(EventBits_t bits) {
+    if (bits & connectionBit) {
+      runRequestedConnection();
+    }
+    if (bits & centersSaveBit) {
+      runRequestedCentersSave();
+    }
+  }
+
+  void runRequestedConnection() {
+    if (!isConnectionRequested) {
+      return;
+    }
+    isConnectionRequested = false;
+    if (connectToServer(connectingAddress, connectingRetryCount) &&
+        isConnected()) {
+      countFailedConnection = 0;
+      return;
+    }
+    connectionState = ConnectionState::Scanning;
+    if (isConnectingPeer) {
+      return;  // the controller may be off
+    }
+    ++countFailedConnection;
+    if (countFailedConnection >= countFailedConnectionToUnbond) {
+      // pairing again may fix a broken bond
+      NimBLEDevice::deleteBond(connectingAddress);
+      countFailedConnection = 0;
+    }
+    // reset();
+  }
+
+  static void connectionTaskMain(void* pvParameters) {
+    auto controller = (BasicGamepadController*)pvParameters;
+    for (;;) {
+      EventBits_t bits = xEventGroupWaitBits(
+          controller->connectionEvents,
+          controller->connectionBit | controller->centersSaveBit, pdTRUE,
+          pdFALSE, portMAX_DELAY);
+      controller->runRequests(bits);
+    }
+  }
+
+  void setTargetAsPeer(const String& targetDeviceAddress) {
+    if (targetDeviceAddress != "") {
+      peerAddress = NimBLEAddress(targetDeviceAddress.c_str());
+      hasPeerAddress = true;
+      hasTargetAddress = true;
+    }
+  }
+
+  void rememberPeer(const NimBLEAddress& address) {
+    if (!remembersPeer || hasTargetAddress) {
+      return;
+    }
+    if (hasPeerAddress && peerAddress.equals(address) &&
+        peerAddress.getType() == address.getType()) {
+      return;  // keep NVS writes for new controllers
+    }
+    peerAddress = address;
+    hasPeerAddress = true;
+    PeerAddressStore().save(address.getNative(), address.getType());
+  }
+
+  // Rate limited to spare the flash. The NVS write runs in the connection
+  // task so onLoop() does not wait for the flash.
+  void requestMovedCentersSave() {
+    if (isCentersSaveRequested ||
+        millis() - centersSavedAt < centerSaveIntervalMs) {
+      return;
+    }
+    centersSavedAt = millis();
+    StickCenters centers;
+    centers.readFrom(axisNormalizer);
+    if (centers.maxJoy != 0 && centers.differsFrom(savedCenters)) {
+      pendingCenters = centers;
+      memcpy(pendingCentersAddress, deviceAddressArr, deviceAddressLen);
+      isCentersSaveRequested = true;
+      xEventGroupSetBits(connectionEvents, centersSaveBit);
+    }
+  }
+
+  // Called from the connection task
+  void runRequestedCentersSave() {
+    if (!isCentersSaveRequested) {
+      return;
+    }
+    CenterStore().save(pendingCentersAddress, pendingCenters);
+    savedCenters = pendingCenters;
+    isCentersSaveRequested = false;
+  }
+
+  // Connected to the address or about to connect to it
+  bool isAssigned(const NimBLEAddress& address) {
+    if (advDevice != nullptr) {
+      return advDevice->getAddress().equals(address);
+    }
+    if (isConnecting()) {
+      return connectingAddress.equals(address);
+    }
+    return isConnected() && memcmp(deviceAddressArr, address.getNative(),
+                                   deviceAddressLen) == 0;
+  }
+
+  void flushScheduledHIDReport() {
+    if (!rumbleScheduler.hasPending()) {
+      return;
+    }
+    if (pCharaOutput == nullptr) {
+      rumbleScheduler.drop();
+      return;
+    }
+    uint8_t dataArr[RumbleScheduler::maxReportLen];
+    size_t dataLen;
+    if (rumbleScheduler.takeDue(millis(), dataArr, dataLen)) {
+      writeHIDReport(dataArr, dataLen);
+    }
+  }
+
   // void reset() {
   //   NimBLEDevice::deinit(true);
   //   delay(500);
@@ -326,14 +969,19 @@ class GamepadController {
 
   /** Handles the provisioning of clients and connects / interfaces with the
    * server */
-  bool connectToServer(NimBLEAdvertisedDevice* advDevice) {
+  bool connectToServer(const NimBLEAddress& address, int retryCount) {
     NimBLEClient* pClient = nullptr;
 
     /** Check if we have a client we should reuse first **/
     if (NimBLEDevice::getClientListSize()) {
-      pClient = NimBLEDevice::getClientByPeerAddress(advDevice->getAddress());
+      pClient = NimBLEDevice::getClientByPeerAddress(address);
       if (pClient) {
-        pClient->connect();
+        setInitialConnectionParams(pClient);
+        // the client may have been created by another pad of a hub
+        pClient->setClientCallbacks(&clientCBs, false);
+        pClient->setConnectTimeout(connectTimeoutSec);
+        // keep the discovered attributes to skip discovery
+        pClient->connect(false);
       }
     }
 
@@ -353,20 +1001,13 @@ class GamepadController {
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("New client created");
 #endif
 
-      // default values
-      // pClient->setConnectionParams(
-      //     BLE_GAP_INITIAL_CONN_ITVL_MIN, BLE_GAP_INITIAL_CONN_ITVL_MAX,
-      //     BLE_GAP_INITIAL_CONN_LATENCY, BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
-      //     16, 16);
-      // pClient->setConnectionParams(
-      //     BLE_GAP_INITIAL_CONN_ITVL_MIN, BLE_GAP_INITIAL_CONN_ITVL_MAX,
-      //     BLE_GAP_INITIAL_CONN_LATENCY, BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
-      //     100, 100);
-      pClient->setClientCallbacks(clientCBs, true);
-      pClient->connect(advDevice, true);
+      setInitialConnectionParams(pClient);
+      // callbacks are owned by the controller
+      pClient->setClientCallbacks(&clientCBs, false);
+      pClient->setConnectTimeout(connectTimeoutSec);
+      pClient->connect(address, true);
     }
 
-    int retryCount = retryCountInOneConnection;
     while (!pClient->isConnected()) {
       if (retryCount <= 0) {
         return false;
@@ -383,7 +1024,7 @@ class GamepadController {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(pClient->toString().c_str());
 #endif
-      pClient->connect(true);
+      pClient->connect(false);
       --retryCount;
     }
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
@@ -396,6 +1037,10 @@ class GamepadController {
 
     // pClient->discoverAttributes();
 
+    // reports fit in one packet anyway, the longer length is for the map
+    pClient->setDataLen(251);
+    requestPhy(pClient);
+
     bool result = afterConnect(pClient);
     if (!result) {
       return result;
@@ -404,28 +1049,115 @@ class GamepadController {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
     GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Done with this device!");
 #endif
-    pConnectedClient = pClient;
+    this->pClient = pClient;
+    rememberPeer(pClient->getPeerAddress());
     return true;
   }
 
+  void setInitialConnectionParams(NimBLEClient* pClient) {
+    const ConnectionProfile& p = connectionProfile;
+    pClient->setConnectionParams(p.minInterval, p.maxInterval, p.latency,
+                                 p.timeout);
+  }
+
+  void applyConnectionProfile(NimBLEClient* pClient) {
+    const ConnectionProfile& p = connectionProfile;
+    pClient->updateConnParams(p.minInterval, p.maxInterval, p.latency,
+                              p.timeout);
+    requestPhy(pClient);
+  }
+
+  void requestPhy(NimBLEClient* pClient) {
+#ifdef GAMEPAD_CONTROLLER_BLE5
+    uint8_t phyMask = connectionProfile.prefers2MPhy ? BLE_GAP_LE_PHY_2M_MASK
+                                                     : BLE_GAP_LE_PHY_1M_MASK;
+    ble_gap_set_prefered_le_phy(pClient->getConnId(), phyMask, phyMask,
+                                BLE_GAP_LE_PHY_CODED_ANY);
+#else
+    (void)pClient;
+#endif
+  }
+
   bool afterConnect(NimBLEClient* pClient) {
+    pCharaOutput = nullptr;
+    pCharaBattery = nullptr;
+    changeFilter.reset();
     memcpy(deviceAddressArr, pClient->getPeerAddress().getNative(),
            deviceAddressLen);
-    for (auto pService : *pClient->getServices(true)) {
-      auto sUuid = pService->getUUID();
-      if (!sUuid.equals(uuidServiceHid) && !sUuid.equals(uuidServiceBattery)) {
-        continue;  // skip
+    if (tracksCenter) {
+      hasLoadedCenters = false;
+      if (!CenterStore().load(deviceAddressArr, savedCenters)) {
+        savedCenters.maxJoy = 0;
+      }
+      loadedCenters = savedCenters;
+      hasLoadedCenters = true;
+      centersSavedAt = millis();
+    }
+    bool needsReportMap = gamepadNotif->usesReportMap() &&
+                          !gamepadNotif->loadCachedReportMap(deviceAddressArr);
+    // the output report, or the first writable report without a reference
+    NimBLERemoteCharacteristic* pOutput = nullptr;
+    NimBLERemoteCharacteristic* pWritableReport = nullptr;
+    connectionState = ConnectionState::Discovering;
+    // discover only the used services, in the order of their handles
+    const NimBLEUUID* serviceUuids[] = {&uuidServiceBattery, &uuidServiceHid};
+    NimBLERemoteService* pServices[2];
+    for (int i = 0; i < 2; ++i) {
+      auto pService = pClient->getService(*serviceUuids[i]);
+      pServices[i] = pService;
+      if (pService == nullptr) {
+        continue;
       }
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(
           pService->toString().c_str());
 #endif
-      for (auto pChara : *pService->getCharacteristics(true)) {
+      // characteristics are kept from the previous connection of the client
+      if (pService->getCharacteristics(false)->empty()) {
+        pService->getCharacteristics(true);
+      }
+    }
+
+    if (!pClient->isConnected()) {
+      return false;  // disconnected while discovering
+    }
+    connectionState = ConnectionState::Subscribing;
+    for (auto pService : pServices) {
+      if (pService == nullptr) {
+        continue;
+      }
+      auto sUuid = pService->getUUID();
+      for (auto pChara : *pService->getCharacteristics(false)) {
+        if (gamepadNotif->usesReportMap() &&
+            pChara->getUUID().equals(uuidCharaReportMap)) {
+          // read only when the parsed map is not cached
+          if (needsReportMap) {
+            readReportMap(pChara);
+          }
+          continue;
+        }
+        if (sUuid.equals(uuidServiceBattery) && pChara->canNotify()) {
+          pCharaBattery = pChara;  // before its first notification
+        }
         charaHandle(pChara);
         charaSubscribeNotification(pChara);
+        if (pOutput == nullptr && sUuid.equals(uuidServiceHid) &&
+            pChara->getUUID().equals(uuidCharaReport) && pChara->canWrite()) {
+          int reportType = readReportType(pChara);
+          if (reportType == reportTypeOutput) {
+            pOutput = pChara;
+          } else if (reportType < 0 && pWritableReport == nullptr) {
+            pWritableReport = pChara;
+          }
+        }
       }
     }
+    pCharaOutput = pOutput != nullptr ? pOutput : pWritableReport;
 
+    if (connectionState == ConnectionState::Subscribing &&
+        pClient->isConnected()) {
+      connectionState = ConnectionState::WaitingForFirstNotification;
+    }
     return true;
   }
 
@@ -470,6 +1202,30 @@ class GamepadController {
     }
   }
 
+  // Type in the Report Reference descriptor, -1 without the descriptor
+  static int readReportType(NimBLERemoteCharacteristic* pChara) {
+    auto pDesc = pChara->getDescriptor(uuidDescReportReference);
+    if (pDesc == nullptr) {
+      return -1;
+    }
+    auto str = pDesc->readValue();
+    return str.size() >= 2 ? (uint8_t)str.data()[1] : -1;
+  }
+
+  void readReportMap(NimBLERemoteCharacteristic* pChara) {
+    auto str = pChara->readValue();
+    if (gamepadNotif->parseReportMap(
+            deviceAddressArr, (const uint8_t*)str.data(), str.size())) {
+#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
+      GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("parsed report map");
+#endif
+    } else {
+#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
+      GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("unknown report map");
+#endif
+    }
+  }
+
   void charaSubscribeNotification(NimBLERemoteCharacteristic* pChara) {
     if (pChara->canNotify()) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
@@ -478,7 +1234,8 @@ class GamepadController {
 #endif
       if (pChara->subscribe(
               true,
-              std::bind(&GamepadController::notifyCB, this, std::placeholders::_1,
+              std::bind(&BasicGamepadController::notifyCB, this,
+                        std::placeholders::_1,
                         std::placeholders::_2, std::placeholders::_3,
                         std::placeholders::_4),
               true)) {
@@ -494,9 +1251,63 @@ class GamepadController {
     }
   }
 
+  void queueCapture(uint16_t reportId, const uint8_t* data, size_t length) {
+    // counted before checking isCapturing, so stopCapture() can wait for it
+    countCapturePushing.fetch_add(1);
+    if (isCapturing.load()) {
+      if (length <= ReportCaptureWriter::maxReportLen) {
+        RawReport report;
+        report.timestampUs = micros();
+        report.reportId = reportId;
+        report.length = length;
+        memcpy(report.data, data, length);
+        pCaptureQueue->push(report);
+      } else {
+        ++countCaptureTooLong;
+      }
+    }
+    countCapturePushing.fetch_sub(1);
+  }
+
+  void flushCapture() {
+    RawReport report;
+    uint8_t record[ReportCaptureWriter::maxRecordLen];
+    while (pCaptureQueue->pop(report)) {
+      pCaptureOutput->write(
+          record, captureWriter.write(report.timestampUs, report.reportId,
+                                      report.data, report.length, record));
+    }
+  }
+
+  // Runs for every decoded report, also the ones the change filter drops,
+  // because a resting stick often repeats the same report
+  void trackCenters(const Parser& parser) {
+    axisNormalizer.setRange(parser.getMaxJoy(), parser.getMaxTrig());
+    if (hasLoadedCenters) {
+      // another controller may have moved the centers
+      if (!loadedCenters.applyTo(axisNormalizer)) {
+        axisNormalizer.resetCenters();
+      }
+      hasLoadedCenters = false;
+    }
+    centerTracker.update(parser.state, axisNormalizer);
+  }
+
+  void normalizeAxes(const Parser& parser) {
+    axisNormalizer.setRange(parser.getMaxJoy(), parser.getMaxTrig());
+    if (isCenterCalibrationRequested) {
+      axisNormalizer.calibrateCenter(parser.state);
+      isCenterCalibrationRequested = false;
+    }
+    NormalizedGamepadState normalized;
+    if (axisNormalizer.normalize(parser.state, normalized)) {
+      normalizedSnapshot.publish(normalized);
+    }
+  }
+
   void notifyCB(NimBLERemoteCharacteristic* pRemoteCharacteristic,
                 uint8_t* pData, size_t length, bool isNotify) {
-    auto sUuid = pRemoteCharacteristic->getRemoteService()->getUUID();
+    (void)isNotify;
     if (connectionState != ConnectionState::Connected) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(
@@ -504,7 +1315,8 @@ class GamepadController {
 #endif
       connectionState = ConnectionState::Connected;
     }
-    if (sUuid.equals(uuidServiceHid)) {
+    // only the HID and battery services are subscribed
+    if (pRemoteCharacteristic != pCharaBattery) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       static bool isPrinting = false;
       static unsigned long printedAt = 0;
@@ -528,27 +1340,68 @@ class GamepadController {
       }
       GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("");
 #endif
-      gamepadNotif->update(pData, length);
       receivedNotificationAt = millis();
+      queueCapture(pRemoteCharacteristic->getHandle(), pData, length);
+      Parser& parser = notifStorage.get();
+#ifdef GAMEPAD_CONTROLLER_STATS
+      uint32_t startedAtUs = micros();
+      if (stats.countNotification != 0) {
+        stats.intervalUs.add(startedAtUs - stats.lastNotificationUs);
+      }
+      stats.lastNotificationUs = startedAtUs;
+      ++stats.countNotification;
+      GamepadState previousState = parser.state;
+#endif
+      // an equal report decodes to the same state, nothing to dispatch
+      bool isSameReport =
+          suppressesDuplicates && changeFilter.isSameRaw(pData, length);
+      uint8_t result = isSameReport ? 0 : parser.update(pData, length);
+#ifdef GAMEPAD_CONTROLLER_STATS
+      if (result == 0 && (isSameReport || parser.state == previousState)) {
+        ++stats.countDuplicate;
+      }
+#endif
+      if (result == 0 && normalizesAxes && tracksCenter) {
+        trackCenters(parser);
+      }
+      bool shouldDispatch = result == 0 && !isSameReport;
+      if (shouldDispatch && suppressesDuplicates) {
+        changeFilter.rememberRaw(pData, length);
+        shouldDispatch = changeFilter.shouldDispatch(parser.state);
+      }
+      if (shouldDispatch) {
+        stateSnapshot.publish(parser.state);
+        if (normalizesAxes) {
+          normalizeAxes(parser);
+        }
+        buttonEdges.update(parser.state.buttons);
+#ifdef GAMEPAD_CONTROLLER_REPORT_QUEUE_SIZE
+        TimedReport report;
+        report.timestampUs = micros();
+        report.state = parser.state;
+        reportQueue.push(report);
+#endif
+        TaskHandle_t listener = reportListenerTask;
+        if (listener != nullptr) {
+          xTaskNotifyGive(listener);
+        }
+      }
+#ifdef GAMEPAD_CONTROLLER_STATS
+      if (result == GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH) {
+        ++stats.countInvalidLength;
+      }
+      stats.processingUs.add(micros() - startedAtUs);
+#endif
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       // GAMEPAD_CONTROLLER_DEBUG_SERIAL.print(gamepadNotif->toString());
       printedAt = millis();
       isPrinting = false;
 #endif
     } else {
-      if (sUuid.equals(uuidServiceBattery)) {
-        battery = pData[0];
+      battery = pData[0];
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
-        GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("battery notification");
+      GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("battery notification");
 #endif
-      } else {
-#ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
-        GAMEPAD_CONTROLLER_DEBUG_SERIAL.printf("s:%s",
-                                                     sUuid.toString().c_str());
-        GAMEPAD_CONTROLLER_DEBUG_SERIAL.println(
-            "not handled notification");
-#endif
-      }
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
       for (int i = 0; i < length; ++i) {
         GAMEPAD_CONTROLLER_DEBUG_SERIAL.printf(" %02x", pData[i]);
@@ -557,12 +1410,146 @@ class GamepadController {
 #endif
     }
   }
+};
+
+typedef BasicGamepadController<GamepadControllerNotificationParser>
+    GamepadController;
 
-  static void scanCompleteCB(NimBLEScanResults results) {
+// Connects up to CountPad controllers with one scan, which keeps running
+// while a pad is free. Each pad is a controller of its own, so snapshots,
+// button edges and output reports are per pad, and notifications reach their
+// pad through the subscription bound to it.
+template <typename Parser, size_t CountPad = NIMBLE_MAX_CONNECTIONS>
+class BasicGamepadHub : public NimBLEAdvertisedDeviceCallbacks {
+ public:
+  typedef BasicGamepadController<Parser> Pad;
+  static const size_t countPad = CountPad;
+
+  BasicGamepadHub(String targetDeviceAddress = "")
+      : filter(targetDeviceAddress) {
+    for (size_t i = 0; i < CountPad; ++i) {
+      pads[i].remembersPeer = false;
+    }
+  }
+
+  // Starts one connection task shared by the pads, which connect in turn
+  void begin(UBaseType_t connectionTaskPriority = 1) {
+    beginGamepadDevice();
+    if (connectionTask == nullptr) {
+      connectionEvents = xEventGroupCreate();
+      xTaskCreate(connectionTaskMain, "gamepadHubConn",
+                  Pad::connectionTaskStackSize, this, connectionTaskPriority,
+                  &connectionTask);
+      for (size_t i = 0; i < CountPad; ++i) {
+        pads[i].connectionTask = connectionTask;
+        pads[i].connectionEvents = connectionEvents;
+        pads[i].connectionBit = (EventBits_t)1 << i;
+        pads[i].centersSaveBit = (EventBits_t)1 << (CountPad + i);
+      }
+    }
+  }
+
+  void onLoop() {
+    bool hasFoundPad = false;
+    for (size_t i = 0; i < CountPad; ++i) {
+      hasFoundPad = hasFoundPad || pads[i].advDevice != nullptr;
+    }
+    if (hasFoundPad && isScanning()) {
+      // a connection cannot start while scanning
+      NimBLEDevice::getScan()->stop();
+    }
+    bool hasFreePad = false;
+    bool isConnecting = false;
+    for (size_t i = 0; i < CountPad; ++i) {
+      pads[i].runLoop(false);
+      hasFreePad = hasFreePad || !pads[i].isConnected();
+      isConnecting = isConnecting || pads[i].isConnecting();
+    }
+    if (hasFreePad && !isConnecting && !isScanning()) {
+      startGamepadScan(this, scanTime);
+    }
+  }
+
+  Pad& getPad(size_t index) { return pads[index]; }
+
+  // Connects only to addresses matching one of the rules. Addresses of OUI
+  // rules also have to advertise like a controller.
+  void setAddressRules(const GamepadAddressRule* rules, uint8_t countRule) {
+    filter.setAddressRules(rules, countRule);
+  }
+
+  void setConnectionProfile(const ConnectionProfile& profile) {
+    for (size_t i = 0; i < CountPad; ++i) {
+      pads[i].setConnectionProfile(profile);
+    }
+  }
+  uint32_t getCountAdvertSeen() { return filter.getCountSeen(); }
+  uint32_t getCountAdvertRejected() { return filter.getCountRejected(); }
+
+  size_t getCountConnected() {
+    size_t count = 0;
+    for (size_t i = 0; i < CountPad; ++i) {
+      if (pads[i].isConnected()) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+ private:
+  static_assert(CountPad > 0 && CountPad <= NIMBLE_MAX_CONNECTIONS,
+                "CountPad must fit in NIMBLE_MAX_CONNECTIONS");
+  // event groups have 24 bits
+  static_assert(CountPad * 2 <= 24, "CountPad must fit in an event group");
+
+  AdvertisedDeviceFilter filter;
+  Pad pads[CountPad];
+  uint32_t scanTime = 4; /** 0 = scan forever */
+  TaskHandle_t connectionTask = nullptr;
+  EventGroupHandle_t connectionEvents = nullptr;
+  static const EventBits_t allRequestBits =
+      ((EventBits_t)1 << (CountPad * 2)) - 1;
+
+  static void connectionTaskMain(void* pvParameters) {
+    auto hub = (BasicGamepadHub*)pvParameters;
+    for (;;) {
+      EventBits_t bits =
+          xEventGroupWaitBits(hub->connectionEvents, allRequestBits, pdTRUE,
+                              pdFALSE, portMAX_DELAY);
+      for (size_t i = 0; i < CountPad; ++i) {
+        hub->pads[i].runRequests(bits);
+      }
+    }
+  }
+
+  bool isScanning() { return NimBLEDevice::getScan()->isScanning(); }
+
+  void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
+    if (!filter.isTarget(advertisedDevice)) {
+      return;
+    }
+    Pad* pFreePad = nullptr;
+    for (size_t i = 0; i < CountPad; ++i) {
+      if (pads[i].isAssigned(advertisedDevice->getAddress())) {
+        return;
+      }
+      if (pFreePad == nullptr && !pads[i].isConnected() &&
+          !pads[i].isConnecting() && pads[i].advDevice == nullptr) {
+        pFreePad = &pads[i];
+      }
+    }
+    if (pFreePad != nullptr) {
 #ifdef GAMEPAD_CONTROLLER_DEBUG_SERIAL
-    GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Scan Ended");
+      GAMEPAD_CONTROLLER_DEBUG_SERIAL.println("Found target");
 #endif
+      pFreePad->connectionState = ConnectionState::Found;
+      pFreePad->advDevice = advertisedDevice;
+    }
   }
 };
 
+template <size_t CountPad = NIMBLE_MAX_CONNECTIONS>
+using GamepadHub =
+    BasicGamepadHub<GamepadControllerNotificationParser, CountPad>;
+
 };  // namespace GamepadControllerESP32
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+// Only toString() needs the Arduino core, the decoders build on any host.
+#ifdef ARDUINO
 #include "Arduino.h"
+#endif
 
-#define GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH 1
+#include "GamepadState.h"
+#include "GamepadStateFormat.h"
 
 namespace GamepadControllerESP32 {
 
@@ -10,6 +17,8 @@ class GamepadControllerNotificationParser {
  public:
   virtual ~GamepadControllerNotificationParser() {};
 
+  // Read-only view of state, regenerated by update() and
+  // updateFieldsFromState(). toArr() encodes state, so write state instead.
   bool btnA, btnB, btnX, btnY;
   bool btnShare, btnStart, btnSelect, btnHome;
   // side top button
@@ -23,9 +32,68 @@ class GamepadControllerNotificationParser {
   uint16_t joyRVert;
   uint16_t trigLT, trigRT;
 
+  // Packed state filled by update() and encoded by toArr()
+  GamepadState state;
+
+  void getState(GamepadState& dest) const { dest = state; }
+
+  // Regenerates the bool/uint16_t fields from state
+  void updateFieldsFromState() {
+    uint32_t buttons = state.buttons;
+    btnA = buttons & GamepadButton::A;
+    btnB = buttons & GamepadButton::B;
+    btnX = buttons & GamepadButton::X;
+    btnY = buttons & GamepadButton::Y;
+    btnShare = buttons & GamepadButton::Share;
+    btnStart = buttons & GamepadButton::Start;
+    btnSelect = buttons & GamepadButton::Select;
+    btnHome = buttons & GamepadButton::Home;
+    btnLB = buttons & GamepadButton::LB;
+    btnRB = buttons & GamepadButton::RB;
+    btnLS = buttons & GamepadButton::LS;
+    btnRS = buttons & GamepadButton::RS;
+    btnDirUp = buttons & GamepadButton::DirUp;
+    btnDirLeft = buttons & GamepadButton::DirLeft;
+    btnDirRight = buttons & GamepadButton::DirRight;
+    btnDirDown = buttons & GamepadButton::DirDown;
+    joyLHori = state.axes[GamepadAxis::LHori];
+    joyLVert = state.axes[GamepadAxis::LVert];
+    joyRHori = state.axes[GamepadAxis::RHori];
+    joyRVert = state.axes[GamepadAxis::RVert];
+    trigLT = state.axes[GamepadAxis::LT];
+    trigRT = state.axes[GamepadAxis::RT];
+  }
+
   virtual uint8_t update(uint8_t* data, size_t length) = 0;
+  // Logical maximums of the sticks and triggers, 0 while unknown
+  virtual uint16_t getMaxJoy() const { return 0; }
+  virtual uint16_t getMaxTrig() const { return 0; }
   virtual uint8_t toArr(uint8_t* data, size_t length) = 0;
+  // Parsers configured from the HID Report Map of the peer return true.
+  // The controller then calls loadCachedReportMap() with the peer address
+  // and reads the map for parseReportMap() only when it returns false.
+  virtual bool usesReportMap() { return false; }
+  virtual bool loadCachedReportMap(const uint8_t* /* address */) {
+    return false;
+  }
+  virtual bool parseReportMap(const uint8_t* /* address */,
+                              const uint8_t* /* data */, size_t /* length */) {
+    return false;
+  }
+
+  // Writes the same text as toString() into buf without allocating
+  virtual size_t format(char* buf, size_t len) {
+    return formatGamepadStateText(state, buf, len);
+  }
+#ifdef ARDUINO
   virtual String toString() = 0;
+
+  size_t printTo(Print& p) {
+    char buf[gamepadStateFormatMaxLen];
+    format(buf, sizeof(buf));
+    return p.print(buf);
+  }
+#endif
 };
 
 };  // namespace GamepadControllerESP32
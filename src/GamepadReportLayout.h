@@ -0,0 +1,95 @@
+#pragma once
+
+#include "GamepadState.h"
+
+namespace GamepadControllerESP32 {
+
+// (data[index] & mask) << shift goes to GamepadState::buttons
+struct GamepadButtonField {
+  uint8_t index;
+  uint8_t mask;
+  uint8_t shift;
+};
+
+// little endian value of 1 or 2 bytes
+struct GamepadAxisField {
+  uint8_t index;
+  uint8_t width;
+};
+
+// Where a controller puts each value in its input report.
+// Provide it as a static constexpr member named layout of a struct, e.g.
+//   struct MyReportLayout { static constexpr GamepadReportLayout layout = {};};
+// so the decoder below is specialized for each controller at compile time.
+struct GamepadReportLayout {
+  static const uint8_t maxButtonField = 4;
+
+  uint8_t expectedDataLen;
+  uint16_t maxJoy;
+  uint16_t maxTrig;
+  uint8_t countButtonField;
+  GamepadButtonField buttonFields[maxButtonField];
+  uint8_t indexHat;
+  // hat value to GamepadButton::Dir* bits >> dirShift, 0 over 15
+  uint8_t hatToDir[16];
+  // GamepadButton::Dir* bits >> dirShift to hat value
+  uint8_t dirToHat[16];
+  // in GamepadAxis order
+  GamepadAxisField axisFields[GamepadAxis::Count];
+};
+
+template <typename Layout>
+inline uint8_t decodeGamepadReport(const uint8_t* data, size_t length,
+                                   GamepadState& state) {
+  const GamepadReportLayout& l = Layout::layout;
+  if (length != l.expectedDataLen) {
+    return GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH;
+  }
+  uint32_t buttons = 0;
+  for (uint8_t i = 0; i < l.countButtonField; ++i) {
+    const GamepadButtonField& f = l.buttonFields[i];
+    buttons |= (uint32_t)(data[f.index] & f.mask) << f.shift;
+  }
+  uint8_t hat = data[l.indexHat];
+  buttons |= (uint32_t)(hat < 16 ? l.hatToDir[hat] : 0)
+             << GamepadButton::dirShift;
+  state.buttons = buttons;
+  for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+    const GamepadAxisField& f = l.axisFields[i];
+    uint16_t value = data[f.index];
+    if (f.width == 2) {
+      value |= (uint16_t)data[f.index + 1] << 8;
+    }
+    state.axes[i] = value;
+  }
+  return 0;
+}
+
+template <typename Layout>
+inline uint8_t encodeGamepadReport(const GamepadState& state, uint8_t* data,
+                                   size_t length) {
+  const GamepadReportLayout& l = Layout::layout;
+  if (length < l.expectedDataLen) {
+    return GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH;
+  }
+  uint32_t buttons = state.buttons;
+  for (uint8_t i = 0; i < l.countButtonField; ++i) {
+    data[l.buttonFields[i].index] = 0;
+  }
+  for (uint8_t i = 0; i < l.countButtonField; ++i) {
+    const GamepadButtonField& f = l.buttonFields[i];
+    data[f.index] |= (buttons >> f.shift) & f.mask;
+  }
+  data[l.indexHat] =
+      l.dirToHat[(buttons & GamepadButton::dirMask) >> GamepadButton::dirShift];
+  for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+    const GamepadAxisField& f = l.axisFields[i];
+    data[f.index] = state.axes[i] & 0xff;
+    if (f.width == 2) {
+      data[f.index + 1] = state.axes[i] >> 8;
+    }
+  }
+  return 0;
+}
+
+};  // namespace GamepadControllerESP32
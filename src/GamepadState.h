@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH 1
+
+namespace GamepadControllerESP32 {
+
+// Bits of GamepadState::buttons.
+// Face, shoulder, menu and stick buttons follow the HID button numbering of
+// BLE gamepads (button n is bit n - 1), so a report byte maps with one mask.
+namespace GamepadButton {
+enum : uint32_t {
+  A = 1UL << 0,
+  B = 1UL << 1,
+  X = 1UL << 3,
+  Y = 1UL << 4,
+  LB = 1UL << 6,
+  RB = 1UL << 7,
+  Select = 1UL << 10,
+  Start = 1UL << 11,
+  Home = 1UL << 12,
+  LS = 1UL << 13,
+  RS = 1UL << 14,
+  Share = 1UL << 15,
+  DirUp = 1UL << 16,
+  DirRight = 1UL << 17,
+  DirDown = 1UL << 18,
+  DirLeft = 1UL << 19,
+};
+static const uint8_t dirShift = 16;
+static const uint32_t dirMask = DirUp | DirRight | DirDown | DirLeft;
+};  // namespace GamepadButton
+
+// Indexes of GamepadState::axes
+namespace GamepadAxis {
+enum : uint8_t {
+  LHori = 0,
+  LVert,
+  RHori,
+  RVert,
+  LT,
+  RT,
+  Count,
+};
+};  // namespace GamepadAxis
+
+// One decoded frame of the controller.
+// Trivially copyable 16 bytes, so copy, compare and queue are word operations.
+struct GamepadState {
+  uint32_t buttons;
+  uint16_t axes[GamepadAxis::Count];
+
+  bool isPressed(uint32_t button) const { return (buttons & button) != 0; }
+  uint16_t getAxis(uint8_t axis) const { return axes[axis]; }
+
+  void reset(uint16_t joyCenter) {
+    buttons = 0;
+    axes[GamepadAxis::LHori] = axes[GamepadAxis::LVert] = joyCenter;
+    axes[GamepadAxis::RHori] = axes[GamepadAxis::RVert] = joyCenter;
+    axes[GamepadAxis::LT] = axes[GamepadAxis::RT] = 0;
+  }
+
+  bool operator==(const GamepadState& other) const {
+    return memcmp(this, &other, sizeof(GamepadState)) == 0;
+  }
+  bool operator!=(const GamepadState& other) const {
+    return !(*this == other);
+  }
+};
+
+static_assert(sizeof(GamepadState) == 16, "GamepadState must stay packed");
+
+};  // namespace GamepadControllerESP32
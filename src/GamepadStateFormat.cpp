@@ -0,0 +1,62 @@
+#include "GamepadStateFormat.h"
+
+#include <stdio.h>
+
+namespace GamepadControllerESP32 {
+
+size_t formatGamepadStateText(const GamepadState& state, char* buf,
+                              size_t len, const char* nameBtnHome) {
+  uint32_t b = state.buttons;
+  const uint16_t* axes = state.axes;
+  // clang-format off
+  return snprintf(buf, len,
+    "btnY: %d btnX: %d btnB: %d btnA: %d btnLB: %d btnRB: %d\n"
+    "btnSelect: %d btnStart: %d %s: %d btnShare: %d btnLS: %d btnRS: %d\n"
+    "btnDirUp: %d btnDirRight: %d btnDirDown: %d btnDirLeft: %d\n"
+    "joyLHori: %u\n"
+    "joyLVert: %u\n"
+    "joyRHori: %u\n"
+    "joyRVert: %u\n"
+    "trigLT: %u\n"
+    "trigRT: %u\n",
+    (b & GamepadButton::Y) != 0, (b & GamepadButton::X) != 0,
+    (b & GamepadButton::B) != 0, (b & GamepadButton::A) != 0,
+    (b & GamepadButton::LB) != 0, (b & GamepadButton::RB) != 0,
+    (b & GamepadButton::Select) != 0, (b & GamepadButton::Start) != 0,
+    nameBtnHome, (b & GamepadButton::Home) != 0,
+    (b & GamepadButton::Share) != 0,
+    (b & GamepadButton::LS) != 0, (b & GamepadButton::RS) != 0,
+    (b & GamepadButton::DirUp) != 0, (b & GamepadButton::DirRight) != 0,
+    (b & GamepadButton::DirDown) != 0, (b & GamepadButton::DirLeft) != 0,
+    axes[GamepadAxis::LHori], axes[GamepadAxis::LVert],
+    axes[GamepadAxis::RHori], axes[GamepadAxis::RVert],
+    axes[GamepadAxis::LT], axes[GamepadAxis::RT]);
+  // clang-format on
+}
+
+size_t formatGamepadStateHex(const GamepadState& state, char* buf, size_t len) {
+  const uint16_t* axes = state.axes;
+  return snprintf(buf, len, "%08lx %04x %04x %04x %04x %04x %04x",
+                  (unsigned long)state.buttons, axes[0], axes[1], axes[2],
+                  axes[3], axes[4], axes[5]);
+}
+
+size_t formatGamepadStateCsv(const GamepadState& state, char* buf, size_t len) {
+  const uint16_t* axes = state.axes;
+  return snprintf(buf, len, "%lu,%u,%u,%u,%u,%u,%u",
+                  (unsigned long)state.buttons, axes[0], axes[1], axes[2],
+                  axes[3], axes[4], axes[5]);
+}
+
+size_t formatGamepadStateJson(const GamepadState& state, char* buf,
+                              size_t len) {
+  const uint16_t* axes = state.axes;
+  return snprintf(buf, len,
+                  "{\"buttons\":%lu,\"joyLHori\":%u,\"joyLVert\":%u,"
+                  "\"joyRHori\":%u,\"joyRVert\":%u,\"trigLT\":%u,"
+                  "\"trigRT\":%u}",
+                  (unsigned long)state.buttons, axes[0], axes[1], axes[2],
+                  axes[3], axes[4], axes[5]);
+}
+
+};  // namespace GamepadControllerESP32
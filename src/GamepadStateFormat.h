@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "GamepadState.h"
+
+namespace GamepadControllerESP32 {
+
+// Buffer size enough for every format below
+static const size_t gamepadStateFormatMaxLen = 320;
+
+// Each function writes a null terminated string into buf without allocating
+// and returns the same value as snprintf.
+
+// Multi-line text, same as toString() of the parsers
+size_t formatGamepadStateText(const GamepadState& state, char* buf,
+                              size_t len, const char* nameBtnHome = "btnHome");
+// Fixed width hex line: buttons then the axes in GamepadAxis order
+// "000a0810 7fff 7fff 7fff 7fff 0000 0000"
+size_t formatGamepadStateHex(const GamepadState& state, char* buf, size_t len);
+// "buttons,joyLHori,joyLVert,joyRHori,joyRVert,trigLT,trigRT"
+size_t formatGamepadStateCsv(const GamepadState& state, char* buf, size_t len);
+// {"buttons":0,"joyLHori":0,"joyLVert":0,...,"trigRT":0}
+size_t formatGamepadStateJson(const GamepadState& state, char* buf, size_t len);
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,88 @@
+#include "GenericControllerNotificationParser.h"
+
+namespace GamepadControllerESP32 {
+
+GenericControllerNotificationParser::CacheEntry
+    GenericControllerNotificationParser::cache[maxCache];
+uint8_t GenericControllerNotificationParser::countCache = 0;
+uint8_t GenericControllerNotificationParser::indexCacheNext = 0;
+std::mutex GenericControllerNotificationParser::cacheMutex;
+
+GenericControllerNotificationParser::GenericControllerNotificationParser() {
+  state.reset(0);
+  updateFieldsFromState();
+}
+
+uint8_t GenericControllerNotificationParser::update(uint8_t* data,
+                                                    size_t length) {
+  if (!hasPlan) {
+    return GAMEPAD_CONTROLLER_ERROR_NO_REPORT_MAP;
+  }
+  uint8_t result = plan.decode(data, length, state);
+  if (result == 0) {
+    updateFieldsFromState();
+  }
+  return result;
+}
+
+uint8_t GenericControllerNotificationParser::toArr(uint8_t* data,
+                                                   size_t length) {
+  if (!hasPlan) {
+    return GAMEPAD_CONTROLLER_ERROR_NO_REPORT_MAP;
+  }
+  return plan.encode(state, data, length);
+}
+
+#ifdef ARDUINO
+String GenericControllerNotificationParser::toString() {
+  char buf[gamepadStateFormatMaxLen];
+  format(buf, sizeof(buf));
+  return String(buf);
+}
+#endif
+
+bool GenericControllerNotificationParser::loadCachedReportMap(
+    const uint8_t* address) {
+  hasPlan = false;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (uint8_t i = 0; i < countCache; ++i) {
+      if (memcmp(cache[i].address, address, sizeof(cache[i].address)) == 0) {
+        plan = cache[i].plan;
+        hasPlan = true;
+        break;
+      }
+    }
+  }
+  if (!hasPlan) {
+    return false;
+  }
+  state.reset(plan.maxJoy / 2);
+  updateFieldsFromState();
+  return true;
+}
+
+bool GenericControllerNotificationParser::parseReportMap(
+    const uint8_t* address, const uint8_t* data, size_t length) {
+  hasPlan = false;
+  if (!plan.parse(data, length)) {
+    return false;
+  }
+  hasPlan = true;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    // the oldest entry is replaced when full
+    CacheEntry& entry = cache[indexCacheNext];
+    memcpy(entry.address, address, sizeof(entry.address));
+    entry.plan = plan;
+    indexCacheNext = (indexCacheNext + 1) % maxCache;
+    if (countCache < maxCache) {
+      ++countCache;
+    }
+  }
+  state.reset(plan.maxJoy / 2);
+  updateFieldsFromState();
+  return true;
+}
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+
+#include "GamepadNotificationParser.h"
+#include "HIDReportMap.h"
+
+namespace GamepadControllerESP32 {
+
+// Parser for any BLE gamepad, configured from the HID Report Map read at
+// connection. Parsed plans are kept per peer address so a reconnection
+// skips reading and parsing the map. Each parser decodes with its own copy,
+// so replacing a cache entry never changes the plan of a connected pad.
+class GenericControllerNotificationParser final
+    : public GamepadControllerNotificationParser {
+ public:
+  GenericControllerNotificationParser();
+
+  uint8_t update(uint8_t* data, size_t length);
+  uint8_t toArr(uint8_t* data, size_t length);
+#ifdef ARDUINO
+  String toString();
+#endif
+
+  bool usesReportMap() { return true; }
+  bool loadCachedReportMap(const uint8_t* address);
+  bool parseReportMap(const uint8_t* address, const uint8_t* data,
+                      size_t length);
+
+  uint16_t getMaxJoy() const { return hasPlan ? plan.maxJoy : 0; }
+  uint16_t getMaxTrig() const { return hasPlan ? plan.maxTrig : 0; }
+
+  const HIDReportPlan* getPlan() { return hasPlan ? &plan : nullptr; }
+
+ private:
+  static const uint8_t maxCache = 2;
+
+  struct CacheEntry {
+    uint8_t address[6];
+    HIDReportPlan plan;
+  };
+  static CacheEntry cache[maxCache];
+  static uint8_t countCache;
+  static uint8_t indexCacheNext;
+  // for the connection tasks of several controllers
+  static std::mutex cacheMutex;
+
+  HIDReportPlan plan;
+  bool hasPlan = false;
+};
+
+};  // namespace GamepadControllerESP32
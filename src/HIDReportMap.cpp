@@ -0,0 +1,333 @@
+#include "HIDReportMap.h"
+
+#define HID_ITEM_TYPE_MAIN 0
+#define HID_ITEM_TYPE_GLOBAL 1
+#define HID_ITEM_TYPE_LOCAL 2
+#define HID_ITEM_LONG 0xfe
+
+#define HID_MAIN_INPUT 8
+#define HID_GLOBAL_USAGE_PAGE 0
+#define HID_GLOBAL_LOGICAL_MIN 1
+#define HID_GLOBAL_LOGICAL_MAX 2
+#define HID_GLOBAL_REPORT_SIZE 7
+#define HID_GLOBAL_REPORT_ID 8
+#define HID_GLOBAL_REPORT_COUNT 9
+#define HID_LOCAL_USAGE 0
+#define HID_LOCAL_USAGE_MIN 1
+#define HID_LOCAL_USAGE_MAX 2
+
+#define HID_PAGE_GENERIC_DESKTOP 0x01
+#define HID_PAGE_SIMULATION 0x02
+#define HID_PAGE_BUTTON 0x09
+#define HID_PAGE_CONSUMER 0x0c
+#define HID_USAGE_CONSUMER_RECORD 0xb2
+
+namespace GamepadControllerESP32 {
+
+static const uint8_t noTarget = 0xff;
+static const uint8_t maxUsage = 16;
+static const uint8_t maxReport = 8;
+// hat index 0 (up) to 7 (up left) as GamepadButton::Dir* bits >> dirShift
+static const uint8_t hatToDir[8] = {1, 3, 2, 6, 4, 12, 8, 9};
+// GamepadButton::Dir* bits >> dirShift to hat index, 0xff for neutral
+static const uint8_t dirToHat[16] = {0xff, 0, 2, 1, 4, 0, 3, 1,
+                                     6,    7, 2, 1, 5, 7, 3, 1};
+
+static uint8_t findTarget(uint32_t usage) {
+  uint16_t page = usage >> 16;
+  uint16_t id = usage & 0xffff;
+  if (page == HID_PAGE_GENERIC_DESKTOP) {
+    switch (id) {
+      case 0x30:  // X
+        return GamepadAxis::LHori;
+      case 0x31:  // Y
+        return GamepadAxis::LVert;
+      case 0x32:  // Z
+      case 0x33:  // Rx
+        return GamepadAxis::RHori;
+      case 0x35:  // Rz
+      case 0x34:  // Ry
+        return GamepadAxis::RVert;
+      case 0x39:  // Hat switch
+        return HIDReportTarget::Hat;
+    }
+  } else if (page == HID_PAGE_SIMULATION) {
+    switch (id) {
+      case 0xc5:  // Brake
+        return GamepadAxis::LT;
+      case 0xc4:  // Accelerator
+        return GamepadAxis::RT;
+    }
+  }
+  return noTarget;
+}
+
+static uint32_t extractBits(const uint8_t* data, uint16_t bitOffset,
+                            uint8_t bitSize) {
+  const uint8_t* p = &data[bitOffset >> 3];
+  uint8_t shift = bitOffset & 7;
+  uint8_t countByte = (shift + bitSize + 7) >> 3;
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < countByte; ++i) {
+    value |= (uint32_t)p[i] << (i * 8);
+  }
+  return (value >> shift) & ((1UL << bitSize) - 1);
+}
+
+static void insertBits(uint8_t* data, uint16_t bitOffset, uint8_t bitSize,
+                       uint32_t value) {
+  for (uint8_t i = 0; i < bitSize; ++i) {
+    uint16_t bit = bitOffset + i;
+    uint8_t mask = 1 << (bit & 7);
+    if (value & (1UL << i)) {
+      data[bit >> 3] |= mask;
+    } else {
+      data[bit >> 3] &= ~mask;
+    }
+  }
+}
+
+bool HIDReportPlan::parse(const uint8_t* map, size_t length) {
+  reportId = 0;
+  dataLen = 0;
+  countField = 0;
+  maxJoy = maxTrig = 0;
+
+  // global items
+  uint16_t usagePage = 0;
+  int32_t logicalMin = 0;
+  int32_t logicalMax = 0;
+  uint8_t reportSize = 0;
+  uint8_t reportCount = 0;
+  uint8_t currentReportId = 0;
+  // local items
+  uint32_t usages[maxUsage];
+  uint8_t countUsage = 0;
+  uint32_t usageMin = 0;
+  uint32_t usageMax = 0;
+  // bit offset of the next input field for each report id
+  uint8_t reportIds[maxReport];
+  uint16_t reportBits[maxReport];
+  uint8_t countReport = 0;
+
+  size_t i = 0;
+  while (i < length) {
+    uint8_t prefix = map[i++];
+    if (prefix == HID_ITEM_LONG) {
+      if (i >= length) break;
+      i += 2 + map[i];
+      continue;
+    }
+    uint8_t size = prefix & 0b11;
+    if (size == 3) size = 4;
+    if (i + size > length) break;
+    uint32_t value = 0;
+    for (uint8_t k = 0; k < size; ++k) {
+      value |= (uint32_t)map[i + k] << (k * 8);
+    }
+    int32_t signedValue = value;
+    if (size == 1) signedValue = (int8_t)value;
+    if (size == 2) signedValue = (int16_t)value;
+    i += size;
+    uint8_t type = (prefix >> 2) & 0b11;
+    uint8_t tag = prefix >> 4;
+
+    if (type == HID_ITEM_TYPE_GLOBAL) {
+      switch (tag) {
+        case HID_GLOBAL_USAGE_PAGE:
+          usagePage = value;
+          break;
+        case HID_GLOBAL_LOGICAL_MIN:
+          logicalMin = signedValue;
+          break;
+        case HID_GLOBAL_LOGICAL_MAX:
+          // maps often write 0 to 0xffff as if it was unsigned
+          logicalMax =
+              signedValue < logicalMin ? (int32_t)value : signedValue;
+          break;
+        case HID_GLOBAL_REPORT_SIZE:
+          reportSize = value;
+          break;
+        case HID_GLOBAL_REPORT_ID:
+          currentReportId = value;
+          break;
+        case HID_GLOBAL_REPORT_COUNT:
+          reportCount = value;
+          break;
+      }
+    } else if (type == HID_ITEM_TYPE_LOCAL) {
+      uint32_t usage =
+          size == 4 ? value : ((uint32_t)usagePage << 16) | value;
+      switch (tag) {
+        case HID_LOCAL_USAGE:
+          if (countUsage < maxUsage) usages[countUsage++] = usage;
+          break;
+        case HID_LOCAL_USAGE_MIN:
+          usageMin = usage;
+          break;
+        case HID_LOCAL_USAGE_MAX:
+          usageMax = usage;
+          break;
+      }
+    } else if (type == HID_ITEM_TYPE_MAIN) {
+      if (tag == HID_MAIN_INPUT) {
+        uint8_t r = 0;
+        while (r < countReport && reportIds[r] != currentReportId) ++r;
+        if (r == countReport) {
+          if (countReport == maxReport) break;  // stop parsing
+          reportIds[r] = currentReportId;
+          reportBits[r] = 0;
+          ++countReport;
+        }
+        bool isData = (value & 0b01) == 0;
+        bool isVariable = (value & 0b10) != 0;
+        for (uint8_t n = 0; isData && isVariable && n < reportCount; ++n) {
+          uint32_t usage = 0;
+          if (usageMax != 0) {
+            usage = usageMin + n;
+            if (usage > usageMax) break;
+          } else if (countUsage != 0) {
+            usage = usages[n < countUsage ? n : countUsage - 1];
+          }
+          uint16_t bitOffset = reportBits[r] + n * reportSize;
+          uint16_t id = usage & 0xffff;
+          if ((usage >> 16) == HID_PAGE_BUTTON && reportSize == 1 &&
+              id >= 1 && id <= GamepadButton::dirShift) {
+            // following buttons are packed in one field
+            uint8_t countButton = reportCount - n;
+            if (usageMax != 0 && usageMax - usage + 1 < countButton) {
+              countButton = usageMax - usage + 1;
+            }
+            if (id - 1 + countButton > GamepadButton::dirShift) {
+              countButton = GamepadButton::dirShift - (id - 1);
+            }
+            addField(currentReportId, bitOffset, countButton,
+                     HIDReportTarget::Buttons, id - 1, 0, 1);
+            n += countButton - 1;
+            continue;
+          }
+          if ((usage >> 16) == HID_PAGE_CONSUMER &&
+              id == HID_USAGE_CONSUMER_RECORD && reportSize == 1) {
+            // share button of xbox controllers
+            addField(currentReportId, bitOffset, 1, HIDReportTarget::Buttons,
+                     15, 0, 1);
+            continue;
+          }
+          uint8_t target = findTarget(usage);
+          if (target != noTarget && reportSize <= 16) {
+            addField(currentReportId, bitOffset, reportSize, target, 0,
+                     logicalMin, logicalMax);
+          }
+        }
+        reportBits[r] += reportSize * reportCount;
+      }
+      countUsage = 0;
+      usageMin = usageMax = 0;
+    }
+  }
+
+  for (uint8_t r = 0; r < countReport; ++r) {
+    if (countField != 0 && reportIds[r] == reportId) {
+      dataLen = (reportBits[r] + 7) / 8;
+    }
+  }
+  return isValid();
+}
+
+void HIDReportPlan::addField(uint8_t reportId, uint16_t bitOffset,
+                             uint8_t bitSize, uint8_t target, uint8_t shift,
+                             int32_t logicalMin, int32_t logicalMax) {
+  if (countField == 0) {
+    this->reportId = reportId;  // first report with gamepad values
+  } else if (reportId != this->reportId) {
+    return;
+  }
+  if (countField == maxField) {
+    return;
+  }
+  for (uint8_t i = 0; i < countField; ++i) {
+    if (target != HIDReportTarget::Buttons && fields[i].target == target) {
+      return;  // keep the first usage for each axis
+    }
+  }
+  uint32_t range = logicalMax - logicalMin;
+  if (range > 0xffff) {
+    range = 0xffff;
+  }
+  if (target == GamepadAxis::LHori) {
+    maxJoy = range;
+  } else if (target == GamepadAxis::LT) {
+    maxTrig = range;
+  }
+  HIDReportField& field = fields[countField++];
+  field.bitOffset = bitOffset;
+  field.bitSize = bitSize;
+  field.target = target;
+  field.shift = shift;
+  field.logicalMin = logicalMin;
+}
+
+uint8_t HIDReportPlan::decode(const uint8_t* data, size_t length,
+                              GamepadState& state) const {
+  if (countField == 0) {
+    return GAMEPAD_CONTROLLER_ERROR_NO_REPORT_MAP;
+  }
+  if (length != dataLen) {
+    return GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH;
+  }
+  uint32_t buttons = 0;
+  for (uint8_t i = 0; i < countField; ++i) {
+    const HIDReportField& f = fields[i];
+    uint32_t raw = extractBits(data, f.bitOffset, f.bitSize);
+    if (f.target == HIDReportTarget::Buttons) {
+      buttons |= raw << f.shift;
+      continue;
+    }
+    int32_t value = raw;
+    if (f.logicalMin < 0 && (raw & (1UL << (f.bitSize - 1)))) {
+      value -= 1L << f.bitSize;  // sign extension
+    }
+    value -= f.logicalMin;
+    if (f.target == HIDReportTarget::Hat) {
+      if (0 <= value && value < 8) {
+        buttons |= (uint32_t)hatToDir[value] << GamepadButton::dirShift;
+      }
+      continue;
+    }
+    state.axes[f.target] = value < 0 ? 0 : value > 0xffff ? 0xffff : value;
+  }
+  state.buttons = buttons;
+  return 0;
+}
+
+uint8_t HIDReportPlan::encode(const GamepadState& state, uint8_t* data,
+                              size_t length) const {
+  if (countField == 0) {
+    return GAMEPAD_CONTROLLER_ERROR_NO_REPORT_MAP;
+  }
+  if (length < dataLen) {
+    return GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH;
+  }
+  for (uint8_t i = 0; i < countField; ++i) {
+    const HIDReportField& f = fields[i];
+    uint32_t value;
+    if (f.target == HIDReportTarget::Buttons) {
+      value = state.buttons >> f.shift;
+    } else if (f.target == HIDReportTarget::Hat) {
+      uint8_t hat = dirToHat[(state.buttons & GamepadButton::dirMask) >>
+                             GamepadButton::dirShift];
+      if (hat != 0xff) {
+        value = hat + f.logicalMin;
+      } else {
+        // out of the logical range means neutral
+        value = f.logicalMin > 0 ? 0 : (1UL << f.bitSize) - 1;
+      }
+    } else {
+      value = state.axes[f.target] + f.logicalMin;
+    }
+    insertBits(data, f.bitOffset, f.bitSize, value);
+  }
+  return 0;
+}
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "GamepadState.h"
+
+#define GAMEPAD_CONTROLLER_ERROR_NO_REPORT_MAP 2
+
+namespace GamepadControllerESP32 {
+
+namespace HIDReportTarget {
+enum : uint8_t {
+  // 0 to GamepadAxis::Count - 1 are axes
+  Hat = GamepadAxis::Count,
+  Buttons,
+};
+};  // namespace HIDReportTarget
+
+// One value to extract from the input report
+struct HIDReportField {
+  uint16_t bitOffset;
+  uint8_t bitSize;
+  // HIDReportTarget or GamepadAxis
+  uint8_t target;
+  // bit of GamepadState::buttons for the first button
+  uint8_t shift;
+  int32_t logicalMin;
+};
+
+// Extraction plan of the gamepad input report, built from the HID Report Map
+// (characteristic 0x2a4b) of the peer.
+// Generic Desktop X/Y and Z/Rz (or Rx/Ry) are the sticks, Simulation Brake
+// and Accelerator are the triggers, buttons follow the HID button numbering
+// like GamepadButton.
+class HIDReportPlan {
+ public:
+  static const uint8_t maxField = 12;
+
+  uint8_t reportId = 0;
+  uint8_t dataLen = 0;
+  uint8_t countField = 0;
+  uint16_t maxJoy = 0;
+  uint16_t maxTrig = 0;
+  HIDReportField fields[maxField];
+
+  bool isValid() const { return countField != 0; }
+
+  // Returns false when no gamepad input report is found in the map
+  bool parse(const uint8_t* map, size_t length);
+  uint8_t decode(const uint8_t* data, size_t length, GamepadState& state) const;
+  uint8_t encode(const GamepadState& state, uint8_t* data, size_t length) const;
+
+ private:
+  void addField(uint8_t reportId, uint16_t bitOffset, uint8_t bitSize,
+                uint8_t target, uint8_t shift, int32_t logicalMin,
+                int32_t logicalMax);
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "Xbox/XboxHIDReportBuilder.hpp"
+
+namespace GamepadControllerESP32 {
+
+namespace HapticShape {
+enum : uint8_t {
+  // hold the power of the keyframe until the next keyframe
+  Step = 0,
+  // change the power linearly to the one of the next keyframe
+  Ramp = 1,
+  // repeat pulseActive / pulseSilent until the next keyframe
+  Pulse = 2,
+};
+};  // namespace HapticShape
+
+struct HapticKeyframe {
+  // time from the start of the effect
+  uint16_t atMs;
+  // 0 to 100 for each motor
+  XboxHIDReportBuilder::InfoPower power;
+  // shape of the segment up to the next keyframe
+  uint8_t shape;
+  // value * 0.01 seconds, used by HapticShape::Pulse
+  uint8_t pulseActive;
+  uint8_t pulseSilent;
+};
+
+// The first keyframe is at 0 ms and atMs strictly increases.
+// The last keyframe only marks the end of the effect.
+struct HapticEffect {
+  const HapticKeyframe* keyframes;
+  uint8_t countKeyframe;
+};
+
+// Expands a HapticEffect into output reports on the device.
+// A step is one report whose timeActive covers the whole segment and a pulse
+// train is one report using timeSilent and countRepeat, so only ramps need
+// a report every rampStepMs. Reports are not needed for silent steps
+// because the previous report has already expired at that time.
+class HapticEffectPlayer {
+ public:
+  static const unsigned long maxActiveMs = 2550;
+
+  unsigned long rampStepMs = 50;
+
+  // Returns false and plays nothing when the effect is not valid
+  bool start(const HapticEffect& effect, unsigned long nowMs) {
+    pEffect = isValid(effect) ? &effect : nullptr;
+    index = 0;
+    startedAt = nowMs;
+    nextReportAt = nowMs;
+    isStopping = false;
+    return pEffect != nullptr;
+  }
+
+  static bool isValid(const HapticEffect& effect) {
+    if (effect.countKeyframe < 2 || effect.keyframes[0].atMs != 0) {
+      return false;
+    }
+    for (uint8_t i = 1; i < effect.countKeyframe; ++i) {
+      if (effect.keyframes[i].atMs <= effect.keyframes[i - 1].atMs) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void stop() {
+    if (pEffect != nullptr) {
+      pEffect = nullptr;
+      isStopping = true;
+    }
+  }
+
+  bool isPlaying() const { return pEffect != nullptr || isStopping; }
+
+  // Fills repo and returns true when a report has to be written at nowMs
+  bool update(unsigned long nowMs, XboxHIDReportBuilder::XboxReportBase& repo) {
+    if (isStopping) {
+      isStopping = false;
+      repo.setAllOff();
+      return true;
+    }
+    if (pEffect == nullptr || (long)(nowMs - nextReportAt) < 0) {
+      return false;
+    }
+    const HapticKeyframe* keyframes = pEffect->keyframes;
+    unsigned long elapsed = nowMs - startedAt;
+    while (index + 1 < pEffect->countKeyframe &&
+           keyframes[index + 1].atMs <= elapsed) {
+      ++index;
+    }
+    if (index + 1 >= pEffect->countKeyframe) {
+      pEffect = nullptr;  // the last report expires by itself
+      return false;
+    }
+    const HapticKeyframe& from = keyframes[index];
+    const HapticKeyframe& to = keyframes[index + 1];
+    unsigned long remainingMs = to.atMs - elapsed;
+
+    if (from.shape == HapticShape::Ramp) {
+      unsigned long stepMs =
+          remainingMs < rampStepMs ? remainingMs : rampStepMs;
+      XboxHIDReportBuilder::InfoPower power;
+      interpolate(from, to, elapsed, power);
+      setReport(repo, power, toTime(stepMs), 0, 0);
+      nextReportAt = nowMs + stepMs;
+      return true;
+    }
+
+    unsigned long periodMs =
+        ((unsigned long)from.pulseActive + from.pulseSilent) * 10;
+    if (from.shape == HapticShape::Pulse && periodMs != 0 &&
+        remainingMs >= periodMs) {
+      unsigned long countPulse = remainingMs / periodMs;
+      if (countPulse > 256) {
+        countPulse = 256;
+      }
+      setReport(repo, from.power, from.pulseActive, from.pulseSilent,
+                countPulse - 1);
+      nextReportAt = nowMs + countPulse * periodMs;
+      return true;
+    }
+
+    unsigned long activeMs =
+        remainingMs < maxActiveMs ? remainingMs : maxActiveMs;
+    nextReportAt = nowMs + activeMs;
+    if (from.shape == HapticShape::Pulse && periodMs != 0 &&
+        (unsigned long)from.pulseActive * 10 < activeMs) {
+      activeMs = (unsigned long)from.pulseActive * 10;  // last partial pulse
+    }
+    if (isSilent(from.power)) {
+      return false;
+    }
+    setReport(repo, from.power, toTime(activeMs), 0, 0);
+    return true;
+  }
+
+ private:
+  const HapticEffect* pEffect = nullptr;
+  uint8_t index = 0;
+  unsigned long startedAt = 0;
+  unsigned long nextReportAt = 0;
+  bool isStopping = false;
+
+  static uint8_t toTime(unsigned long ms) {
+    unsigned long time = (ms + 9) / 10;
+    return time > 255 ? 255 : time;
+  }
+
+  static bool isSilent(const XboxHIDReportBuilder::InfoPower& power) {
+    return power.left == 0 && power.right == 0 && power.shake == 0 &&
+           power.center == 0;
+  }
+
+  static uint8_t lerp(uint8_t from, uint8_t to, unsigned long t,
+                      unsigned long duration) {
+    return from + ((long)to - from) * (long)t / (long)duration;
+  }
+
+  static void interpolate(const HapticKeyframe& from, const HapticKeyframe& to,
+                          unsigned long elapsed,
+                          XboxHIDReportBuilder::InfoPower& power) {
+    unsigned long t = elapsed - from.atMs;
+    unsigned long duration = to.atMs - from.atMs;
+    power.left = lerp(from.power.left, to.power.left, t, duration);
+    power.right = lerp(from.power.right, to.power.right, t, duration);
+    power.shake = lerp(from.power.shake, to.power.shake, t, duration);
+    power.center = lerp(from.power.center, to.power.center, t, duration);
+  }
+
+  static void setReport(XboxHIDReportBuilder::XboxReportBase& repo,
+                        const XboxHIDReportBuilder::InfoPower& power,
+                        uint8_t timeActive, uint8_t timeSilent,
+                        uint8_t countRepeat) {
+    repo.setAllOff();
+    repo.v.select.left = power.left != 0;
+    repo.v.select.right = power.right != 0;
+    repo.v.select.shake = power.shake != 0;
+    repo.v.select.center = power.center != 0;
+    repo.v.power = power;
+    repo.v.timeActive = timeActive;
+    repo.v.timeSilent = timeSilent;
+    repo.v.countRepeat = countRepeat;
+  }
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "GamepadNotificationParser.h"
+#include "GamepadReportLayout.h"
+
+namespace GamepadControllerESP32 {
+
+// Parser generated from a GamepadReportLayout, see GamepadReportLayout.h.
+// Adding a controller only needs a layout:
+//   typedef LayoutControllerNotificationParser<MyReportLayout> MyParser;
+template <typename Layout>
+class LayoutControllerNotificationParser
+    : public GamepadControllerNotificationParser {
+ public:
+  static const size_t expectedDataLen = Layout::layout.expectedDataLen;
+  static const uint16_t maxJoy = Layout::layout.maxJoy;
+  static const uint16_t maxTrig = Layout::layout.maxTrig;
+
+  LayoutControllerNotificationParser() {
+    state.reset(maxJoy / 2);
+    updateFieldsFromState();
+  }
+
+  uint8_t update(uint8_t* data, size_t length) {
+    uint8_t result = decodeGamepadReport<Layout>(data, length, state);
+    if (result == 0) {
+      updateFieldsFromState();
+    }
+    return result;
+  }
+
+  uint8_t toArr(uint8_t* data, size_t length) {
+    return encodeGamepadReport<Layout>(state, data, length);
+  }
+
+  uint16_t getMaxJoy() const { return maxJoy; }
+  uint16_t getMaxTrig() const { return maxTrig; }
+
+#ifdef ARDUINO
+  String toString() {
+    char buf[gamepadStateFormatMaxLen];
+    format(buf, sizeof(buf));
+    return String(buf);
+  }
+#endif
+};
+
+};  // namespace GamepadControllerESP32
@@ -1,35 +1,33 @@
 #pragma once
 
-#include "GamepadNotificationParser.h"
+#include "LayoutControllerNotificationParser.hpp"
 
 namespace GamepadControllerESP32 {
 
-class NewgameControllerNotificationParser : public GamepadControllerNotificationParser {
- public:
-  NewgameControllerNotificationParser();
-
-  // bool btnA, btnB, btnX, btnY;
-  // bool btnShare, btnStart, btnSelect, btnHome;
-  // // side top button
-  // bool btnLB, btnRB;
-  // // button on joy stick
-  // bool btnLS, btnRS;
-  // bool btnDirUp, btnDirLeft, btnDirRight, btnDirDown;
-  // uint16_t joyLHori = maxJoy / 2;
-  // uint16_t joyLVert = maxJoy / 2;
-  // uint16_t joyRHori = maxJoy / 2;
-  // uint16_t joyRVert = maxJoy / 2;
-  // uint16_t trigLT, trigRT;
-  uint8_t update(uint8_t* data, size_t length);
-  uint8_t toArr(uint8_t* data, size_t length);
-  String toString();
-
-  static const size_t expectedDataLen = 9;
-  static const uint16_t maxJoy = 0x80;
-  static const uint16_t maxTrig = 0xff;
-
- private:
-  static void convertU16TU8Arr(uint16_t vU16, uint8_t* data);
+struct NewgameReportLayout {
+  // clang-format off
+  static constexpr GamepadReportLayout layout = {
+    9, 0x80, 0xff,
+    3, {
+      // from bit 0: A B _ X Y _ LB RB
+      {5, 0b11011011, 0},
+      // Start, same bit as xbox
+      {6, 0b00001000, 8},
+      // from bit 0: LS RS
+      // toArr() writes Start, LS and RS to byte 6. Before the layout, the
+      // zeroed share byte at the same index overwrote them.
+      {6, 0b00000011, 13},
+    },
+    // hat value 0 (up) to 7 (up left) clockwise, 0xf neutral
+    4,
+    {1, 3, 2, 6, 4, 12, 8, 9},
+    {0xf, 0, 2, 1, 4, 0, 3, 1, 6, 7, 2, 1, 5, 7, 3, 1},
+    {{0, 1}, {1, 1}, {2, 1}, {3, 1}, {7, 1}, {8, 1}},
+  };
+  // clang-format on
 };
 
+class NewgameControllerNotificationParser final
+    : public LayoutControllerNotificationParser<NewgameReportLayout> {};
+
 };  // namespace GamepadControllerESP32
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace GamepadControllerESP32 {
+
+// Power of two histogram of durations in microseconds.
+// Bucket n counts values from 2^n to 2^(n+1) - 1, bucket 0 also counts 0.
+struct DurationHistogram {
+  static const uint8_t countBucket = 24;  // up to 16 seconds
+
+  uint32_t buckets[countBucket];
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+
+  void reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    minUs = UINT32_MAX;
+    maxUs = 0;
+    sumUs = 0;
+  }
+
+  void add(uint32_t us) {
+    uint8_t bucket = 31 - __builtin_clz(us | 1);
+    if (bucket >= countBucket) {
+      bucket = countBucket - 1;
+    }
+    ++buckets[bucket];
+    ++count;
+    sumUs += us;
+    if (us < minUs) minUs = us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  uint32_t getMeanUs() const { return count == 0 ? 0 : sumUs / count; }
+
+  // Upper bound of the bucket holding the percentile, 0 to 100
+  uint32_t getPercentileUs(uint8_t percent) const {
+    if (count == 0) {
+      return 0;
+    }
+    uint32_t rank = ((uint64_t)count * percent + 99) / 100;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < countBucket; ++i) {
+      total += buckets[i];
+      if (total >= rank && total != 0) {
+        uint32_t upper = (2UL << i) - 1;
+        return upper < maxUs ? upper : maxUs;
+      }
+    }
+    return maxUs;
+  }
+};
+
+// Counters of GAMEPAD_CONTROLLER_STATS, updated from the notification
+// callback without locking, so a read may mix two notifications.
+struct NotificationStats {
+  // between two HID notifications
+  DurationHistogram intervalUs;
+  // time spent in the notification callback
+  DurationHistogram processingUs;
+  uint32_t countNotification;
+  uint32_t countInvalidLength;
+  // decoded to the same state as the previous report
+  uint32_t countDuplicate;
+  uint32_t countDisconnect;
+  uint32_t lastNotificationUs;
+
+  NotificationStats() { reset(); }
+
+  void reset() {
+    intervalUs.reset();
+    processingUs.reset();
+    countNotification = 0;
+    countInvalidLength = 0;
+    countDuplicate = 0;
+    countDisconnect = 0;
+    lastNotificationUs = 0;
+  }
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Varint.hpp"
+
+namespace GamepadControllerESP32 {
+
+// Capture of raw notifications:
+//   header: "GPC" and version 1
+//   record: varint time from the previous record in microseconds
+//           varint report id (characteristic handle on the controller)
+//           varint length << 1 | isDelta
+//           isDelta: bitmask of changed bytes then the changed bytes,
+//                    against the previous report of the same length
+//           else: the raw bytes
+static const uint8_t reportCaptureHeader[] = {'G', 'P', 'C', 1};
+
+struct CapturedReport {
+  // from the first report of the capture
+  uint32_t timestampUs;
+  uint16_t reportId;
+  uint8_t length;
+  const uint8_t* data;
+};
+
+class ReportCaptureWriter {
+ public:
+  static const size_t maxReportLen = 64;
+  static const size_t maxRecordLen =
+      varintMaxLen + 3 + 2 + maxReportLen / 8 + maxReportLen;
+
+  size_t writeHeader(uint8_t* out) {
+    hasPrevious = false;
+    previousLen = 0;
+    memcpy(out, reportCaptureHeader, sizeof(reportCaptureHeader));
+    return sizeof(reportCaptureHeader);
+  }
+
+  // Returns the record length written to out, which needs maxRecordLen
+  // bytes. Reports longer than maxReportLen are skipped and return 0.
+  size_t write(uint32_t timestampUs, uint16_t reportId, const uint8_t* data,
+               size_t length, uint8_t* out) {
+    if (length > maxReportLen) {
+      ++countSkipped;
+      return 0;
+    }
+    uint32_t deltaUs = hasPrevious ? timestampUs - previousTimestampUs : 0;
+    hasPrevious = true;
+    previousTimestampUs = timestampUs;
+    size_t len = writeVarint(deltaUs, out);
+    len += writeVarint(reportId, &out[len]);
+    bool isDelta = length == previousLen && length != 0;
+    len += writeVarint((length << 1) | (isDelta ? 1 : 0), &out[len]);
+    if (isDelta) {
+      uint8_t* mask = &out[len];
+      size_t maskLen = (length + 7) / 8;
+      memset(mask, 0, maskLen);
+      len += maskLen;
+      for (size_t i = 0; i < length; ++i) {
+        if (data[i] != previous[i]) {
+          mask[i >> 3] |= 1 << (i & 7);
+          out[len++] = data[i];
+        }
+      }
+    } else {
+      memcpy(&out[len], data, length);
+      len += length;
+    }
+    memcpy(previous, data, length);
+    previousLen = length;
+    return len;
+  }
+
+  uint32_t getCountSkipped() const { return countSkipped; }
+
+ private:
+  uint8_t previous[maxReportLen];
+  size_t previousLen = 0;
+  uint32_t previousTimestampUs = 0;
+  bool hasPrevious = false;
+  uint32_t countSkipped = 0;
+};
+
+// Notification queued by the controller until it is written to a capture
+struct RawReport {
+  uint32_t timestampUs;
+  uint16_t reportId;
+  uint8_t length;
+  uint8_t data[ReportCaptureWriter::maxReportLen];
+};
+
+// Reads a capture from memory, reports stay valid until the next call
+class ReportCaptureReader {
+ public:
+  bool begin(const uint8_t* capture, size_t length) {
+    p = capture;
+    end = capture + length;
+    timestampUs = 0;
+    previousLen = 0;
+    isBroken = false;
+    if (length < sizeof(reportCaptureHeader) ||
+        memcmp(capture, reportCaptureHeader, sizeof(reportCaptureHeader)) !=
+            0) {
+      isBroken = true;
+      return false;
+    }
+    p += sizeof(reportCaptureHeader);
+    return true;
+  }
+
+  bool next(CapturedReport& report) {
+    if (isBroken || p >= end) {
+      return false;
+    }
+    uint32_t deltaUs, reportId, lengthAndFlag;
+    if (!readVarint(p, end, deltaUs) || !readVarint(p, end, reportId) ||
+        !readVarint(p, end, lengthAndFlag)) {
+      isBroken = true;
+      return false;
+    }
+    size_t length = lengthAndFlag >> 1;
+    bool isDelta = (lengthAndFlag & 1) != 0;
+    if (length > ReportCaptureWriter::maxReportLen ||
+        (isDelta && length != previousLen)) {
+      isBroken = true;
+      return false;
+    }
+    if (isDelta) {
+      const uint8_t* mask = p;
+      size_t maskLen = (length + 7) / 8;
+      if ((size_t)(end - p) < maskLen) {
+        isBroken = true;
+        return false;
+      }
+      p += maskLen;
+      for (size_t i = 0; i < length; ++i) {
+        if (mask[i >> 3] & (1 << (i & 7))) {
+          if (p >= end) {
+            isBroken = true;
+            return false;
+          }
+          data[i] = *p++;
+        }
+      }
+    } else {
+      if ((size_t)(end - p) < length) {
+        isBroken = true;
+        return false;
+      }
+      memcpy(data, p, length);
+      p += length;
+    }
+    previousLen = length;
+    timestampUs += deltaUs;
+    report.timestampUs = timestampUs;
+    report.reportId = reportId;
+    report.length = length;
+    report.data = data;
+    return true;
+  }
+
+  // True when the capture is truncated or not a capture
+  bool hasError() const { return isBroken; }
+  bool isAtEnd() const { return isBroken || p >= end; }
+
+ private:
+  const uint8_t* p = nullptr;
+  const uint8_t* end = nullptr;
+  uint32_t timestampUs = 0;
+  uint8_t data[ReportCaptureWriter::maxReportLen];
+  size_t previousLen = 0;
+  bool isBroken = false;
+};
+
+// Feeds a capture to a parser through update(), as fast as possible with
+// feedNext() or at the captured pace with feedDue().
+class ReportReplay {
+ public:
+  bool begin(const uint8_t* capture, size_t length) {
+    hasPending = false;
+    countFed = countError = 0;
+    return reader.begin(capture, length);
+  }
+
+  template <typename Parser>
+  bool feedNext(Parser& parser) {
+    if (!hasPending && !reader.next(pending)) {
+      return false;
+    }
+    hasPending = false;
+    // the parser takes non-const data like notifications
+    uint8_t data[ReportCaptureWriter::maxReportLen];
+    memcpy(data, pending.data, pending.length);
+    if (parser.update(data, pending.length) != 0) {
+      ++countError;
+    }
+    ++countFed;
+    return true;
+  }
+
+  // Feeds the reports captured up to elapsedUs from the first one and
+  // returns how many were fed
+  template <typename Parser>
+  size_t feedDue(Parser& parser, uint32_t elapsedUs) {
+    size_t count = 0;
+    for (;;) {
+      if (!hasPending) {
+        if (!reader.next(pending)) {
+          break;
+        }
+        hasPending = true;
+      }
+      if (pending.timestampUs > elapsedUs) {
+        break;
+      }
+      feedNext(parser);
+      ++count;
+    }
+    return count;
+  }
+
+  bool isFinished() { return !hasPending && reader.isAtEnd(); }
+  uint32_t getCountFed() const { return countFed; }
+  // reports rejected by the parser
+  uint32_t getCountError() const { return countError; }
+  bool hasError() const { return reader.hasError(); }
+
+ private:
+  ReportCaptureReader reader;
+  CapturedReport pending;
+  bool hasPending = false;
+  uint32_t countFed = 0;
+  uint32_t countError = 0;
+};
+
+};  // namespace GamepadControllerESP32
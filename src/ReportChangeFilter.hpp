@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "GamepadState.h"
+
+namespace GamepadControllerESP32 {
+
+// Drops reports that would not change what consumers see:
+// raw reports equal to the previous decoded one, before decoding, and
+// decoded states with the same buttons and axes within the thresholds of the
+// last dispatched state. Slow moves add up until they pass the threshold.
+class ReportChangeFilter {
+ public:
+  static const size_t maxReportLen = 64;
+
+  // Raw units of the parser, 0 dispatches any change (default)
+  void setAxisThreshold(uint8_t axis, uint16_t threshold) {
+    if (axis < GamepadAxis::Count) {
+      thresholds[axis] = threshold;
+    }
+  }
+  void setAxisThresholds(uint16_t stickThreshold, uint16_t triggerThreshold) {
+    for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+      thresholds[i] = i < GamepadAxis::LT ? stickThreshold : triggerThreshold;
+    }
+  }
+
+  // Forgets the previous report, for a new connection
+  void reset() {
+    previousLen = 0;
+    hasDispatched = false;
+  }
+
+  bool isSameRaw(const uint8_t* data, size_t length) {
+    if (length == 0 || length != previousLen ||
+        memcmp(data, previous, length) != 0) {
+      return false;
+    }
+    ++countSameRaw;
+    return true;
+  }
+
+  // Call after a successful decode of data
+  void rememberRaw(const uint8_t* data, size_t length) {
+    if (length > maxReportLen) {
+      previousLen = 0;
+      return;
+    }
+    memcpy(previous, data, length);
+    previousLen = length;
+  }
+
+  // Returns true and keeps state as the last dispatched one when it differs
+  // enough from it
+  bool shouldDispatch(const GamepadState& state) {
+    if (hasDispatched && state.buttons == dispatched.buttons) {
+      uint8_t i = 0;
+      while (i < GamepadAxis::Count && isWithinThreshold(state, i)) ++i;
+      if (i == GamepadAxis::Count) {
+        ++countBelowThreshold;
+        return false;
+      }
+    }
+    dispatched = state;
+    hasDispatched = true;
+    return true;
+  }
+
+  uint32_t getCountSameRaw() const { return countSameRaw; }
+  uint32_t getCountBelowThreshold() const { return countBelowThreshold; }
+
+ private:
+  uint8_t previous[maxReportLen];
+  size_t previousLen = 0;
+  GamepadState dispatched;
+  bool hasDispatched = false;
+  uint16_t thresholds[GamepadAxis::Count] = {};
+  uint32_t countSameRaw = 0;
+  uint32_t countBelowThreshold = 0;
+
+  bool isWithinThreshold(const GamepadState& state, uint8_t axis) const {
+    uint16_t value = state.axes[axis];
+    uint16_t from = dispatched.axes[axis];
+    uint16_t diff = value > from ? value - from : from - value;
+    return diff <= thresholds[axis];
+  }
+};
+
+};  // namespace GamepadControllerESP32
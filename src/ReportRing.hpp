@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "GamepadState.h"
+
+namespace GamepadControllerESP32 {
+
+struct TimedReport {
+  uint32_t timestampUs;
+  GamepadState state;
+};
+
+// Fixed capacity single-producer/single-consumer queue without allocation.
+// push() is called by the notification task, pop() by one consumer task.
+// When full the newest report is dropped and counted as an overflow.
+template <size_t Capacity, typename T = TimedReport>
+class ReportRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+ public:
+  bool push(const T& report) {
+    uint32_t head = headIndex.load(std::memory_order_relaxed);
+    if (head - tailIndex.load(std::memory_order_acquire) >= Capacity) {
+      overflowCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    reports[head & (Capacity - 1)] = report;
+    headIndex.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& report) {
+    uint32_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail == headIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+    report = reports[tail & (Capacity - 1)];
+    tailIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return headIndex.load(std::memory_order_acquire) -
+           tailIndex.load(std::memory_order_acquire);
+  }
+  size_t capacity() const { return Capacity; }
+  uint32_t getOverflowCount() const {
+    return overflowCount.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint32_t> headIndex{0};
+  std::atomic<uint32_t> tailIndex{0};
+  std::atomic<uint32_t> overflowCount{0};
+  T reports[Capacity];
+};
+
+};  // namespace GamepadControllerESP32
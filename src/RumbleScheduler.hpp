@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace GamepadControllerESP32 {
+
+struct RumbleSchedulerStats {
+  uint32_t countSubmitted;
+  uint32_t countWritten;
+  // replaced by a newer report before being written
+  uint32_t countCoalesced;
+  // discarded because no controller was connected
+  uint32_t countDropped;
+};
+
+// Keeps only the newest pending output report and releases it at most once
+// per interval, so haptics follow the latest command instead of a backlog
+// of writes queued in the BLE stack.
+// submit() and takeDue() are expected to be called from the same task.
+class RumbleScheduler {
+ public:
+  static const size_t maxReportLen = 8;
+
+  void setIntervalMs(unsigned long ms) { intervalMs = ms; }
+  unsigned long getIntervalMs() const { return intervalMs; }
+  bool hasPending() const { return pendingLen != 0; }
+
+  void submit(const uint8_t* data, size_t len) {
+    if (len > maxReportLen) {
+      len = maxReportLen;
+    }
+    if (pendingLen != 0) {
+      ++stats.countCoalesced;
+    }
+    memcpy(pending, data, len);
+    pendingLen = len;
+    ++stats.countSubmitted;
+  }
+
+  // Copies the pending report to data when one is due at nowMs
+  bool takeDue(unsigned long nowMs, uint8_t* data, size_t& len) {
+    if (pendingLen == 0 || (isWritten && nowMs - writtenAt < intervalMs)) {
+      return false;
+    }
+    memcpy(data, pending, pendingLen);
+    len = pendingLen;
+    pendingLen = 0;
+    writtenAt = nowMs;
+    isWritten = true;
+    ++stats.countWritten;
+    return true;
+  }
+
+  void drop() {
+    if (pendingLen != 0) {
+      ++stats.countDropped;
+      pendingLen = 0;
+    }
+  }
+
+  const RumbleSchedulerStats& getStats() const { return stats; }
+
+ private:
+  uint8_t pending[maxReportLen];
+  size_t pendingLen = 0;
+  unsigned long intervalMs = 20;
+  unsigned long writtenAt = 0;
+  bool isWritten = false;
+  RumbleSchedulerStats stats = {0, 0, 0, 0};
+};
+
+};  // namespace GamepadControllerESP32
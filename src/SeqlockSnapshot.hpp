@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace GamepadControllerESP32 {
+
+// Single writer / any reader snapshot without locks.
+// The writer never waits; a reader retries only while a publish overlaps its
+// copy, which is bounded by maxReadRetry.
+template <typename T>
+class SeqlockSnapshot {
+ public:
+  static const uint8_t maxReadRetry = 8;
+
+  void publish(const T& value) {
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    data = value;
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  bool read(T& value) const {
+    for (uint8_t i = 0; i < maxReadRetry; ++i) {
+      uint32_t seqBefore = sequence.load(std::memory_order_acquire);
+      if (seqBefore & 1) {
+        continue;  // publish in progress
+      }
+      value = data;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == seqBefore) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Number of completed publishes
+  uint32_t getCount() const {
+    return sequence.load(std::memory_order_acquire) >> 1;
+  }
+
+ private:
+  std::atomic<uint32_t> sequence{0};
+  T data = T();
+};
+
+};  // namespace GamepadControllerESP32
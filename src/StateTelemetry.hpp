@@ -0,0 +1,243 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "GamepadState.h"
+#include "Varint.hpp"
+
+namespace GamepadControllerESP32 {
+
+// Compact frames of GamepadState to forward over UART or a network.
+// Payload:
+//   flags: bit 7 keyframe, bit 6 buttons, bit n (0 to 5) axis n
+//   sequence: incremented for every frame
+//   keyframe: varint buttons, then varint of every axis
+//   delta: varint of buttons XOR the previous ones when bit 6 is set, then
+//          zigzag varint of the difference of each axis flagged
+//   CRC-8 of the bytes above
+// The payload is COBS encoded and ends with 0, the only 0 of a frame, so a
+// receiver finds the next frame after lost or corrupted bytes. Deltas are
+// ignored after an error or a gap in the sequence until the next keyframe.
+namespace StateTelemetryFlag {
+enum : uint8_t {
+  Keyframe = 0x80,
+  Buttons = 0x40,
+  Axes = 0x3f,
+};
+};  // namespace StateTelemetryFlag
+
+// CRC-8 with polynomial 0x07
+inline uint8_t computeCrc8(const uint8_t* data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Writes data without 0 to out, which needs length + 1 bytes for data
+// shorter than 254 bytes, and returns the written length
+inline size_t encodeCobs(const uint8_t* data, size_t length, uint8_t* out) {
+  size_t codeIndex = 0;
+  size_t len = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < length; ++i) {
+    if (data[i] == 0) {
+      out[codeIndex] = code;
+      codeIndex = len++;
+      code = 1;
+    } else {
+      out[len++] = data[i];
+      ++code;
+    }
+  }
+  out[codeIndex] = code;
+  return len;
+}
+
+// Decodes in place and returns the decoded length, 0 for invalid data
+inline size_t decodeCobs(uint8_t* data, size_t length) {
+  size_t i = 0;
+  size_t len = 0;
+  while (i < length) {
+    uint8_t code = data[i++];
+    if (code == 0 || i + code - 1 > length) {
+      return 0;
+    }
+    // the block moves back by the code bytes seen so far
+    memmove(&data[len], &data[i], code - 1);
+    len += code - 1;
+    i += code - 1;
+    if (code != 0xff && i < length) {
+      data[len++] = 0;
+    }
+  }
+  return len;
+}
+
+class StateTelemetryEncoder {
+ public:
+  static const size_t maxPayloadLen =
+      2 + varintMaxLen + GamepadAxis::Count * 3 + 1;
+  // COBS code byte and the delimiter
+  static const size_t maxFrameLen = maxPayloadLen + 2;
+
+  StateTelemetryEncoder(uint16_t keyframeInterval = 32)
+      : keyframeInterval(keyframeInterval) {}
+
+  // Writes the frame of state to out, which needs maxFrameLen bytes.
+  // Returns 0 when nothing changed and no keyframe is due.
+  size_t encode(const GamepadState& state, uint8_t* out) {
+    bool isKeyframe =
+        !hasPrevious || countSinceKeyframe + 1 >= keyframeInterval;
+    uint8_t payload[maxPayloadLen];
+    size_t len = 2;
+    uint8_t flags = 0;
+    if (isKeyframe) {
+      flags = StateTelemetryFlag::Keyframe;
+      len += writeVarint(state.buttons, &payload[len]);
+      for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+        len += writeVarint(state.axes[i], &payload[len]);
+      }
+      countSinceKeyframe = 0;
+    } else {
+      uint32_t changedButtons = state.buttons ^ previous.buttons;
+      if (changedButtons != 0) {
+        flags |= StateTelemetryFlag::Buttons;
+        len += writeVarint(changedButtons, &payload[len]);
+      }
+      for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+        if (state.axes[i] != previous.axes[i]) {
+          flags |= 1 << i;
+          int32_t diff = (int32_t)state.axes[i] - previous.axes[i];
+          len += writeVarint(encodeZigzag(diff), &payload[len]);
+        }
+      }
+      ++countSinceKeyframe;
+      if (flags == 0) {
+        return 0;
+      }
+    }
+    payload[0] = flags;
+    payload[1] = sequence++;
+    payload[len] = computeCrc8(payload, len);
+    ++len;
+    previous = state;
+    hasPrevious = true;
+    size_t frameLen = encodeCobs(payload, len, out);
+    out[frameLen++] = 0;
+    return frameLen;
+  }
+
+  // The next frame is a keyframe, for a new receiver for example
+  void requestKeyframe() { hasPrevious = false; }
+
+ private:
+  GamepadState previous = GamepadState();
+  bool hasPrevious = false;
+  uint8_t sequence = 0;
+  uint16_t keyframeInterval;
+  uint16_t countSinceKeyframe = 0;
+};
+
+class StateTelemetryDecoder {
+ public:
+  // Takes the received bytes one by one. Returns true when a frame updated
+  // state, which happens from the first keyframe on.
+  bool receive(uint8_t byte, GamepadState& state) {
+    if (byte != 0) {
+      if (frameLen < sizeof(frame)) {
+        frame[frameLen] = byte;
+      }
+      ++frameLen;
+      return false;
+    }
+    size_t len = frameLen;
+    frameLen = 0;
+    if (len == 0) {
+      return false;
+    }
+    if (len > sizeof(frame) || !decodeFrame(len)) {
+      ++countError;
+      hasKeyframe = false;
+      return false;
+    }
+    ++countFrame;
+    if (!hasKeyframe) {
+      return false;
+    }
+    state = current;
+    return true;
+  }
+
+  bool hasState() const { return hasKeyframe; }
+  uint32_t getCountFrame() const { return countFrame; }
+  // frames with a wrong CRC or format
+  uint32_t getCountError() const { return countError; }
+  // gaps found in the sequence
+  uint32_t getCountLost() const { return countLost; }
+
+ private:
+  uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+  size_t frameLen = 0;
+  GamepadState current = GamepadState();
+  bool hasKeyframe = false;
+  uint8_t nextSequence = 0;
+  uint32_t countFrame = 0;
+  uint32_t countError = 0;
+  uint32_t countLost = 0;
+
+  bool decodeFrame(size_t len) {
+    len = decodeCobs(frame, len);
+    if (len < 3 || computeCrc8(frame, len - 1) != frame[len - 1]) {
+      return false;
+    }
+    const uint8_t* p = &frame[2];
+    const uint8_t* end = &frame[len - 1];
+    uint8_t flags = frame[0];
+    uint8_t sequence = frame[1];
+    GamepadState next = current;
+    uint32_t value;
+    if (flags & StateTelemetryFlag::Keyframe) {
+      if (!readVarint(p, end, value)) return false;
+      next.buttons = value;
+      for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+        if (!readVarint(p, end, value)) return false;
+        next.axes[i] = value;
+      }
+    } else {
+      if (flags & StateTelemetryFlag::Buttons) {
+        if (!readVarint(p, end, value)) return false;
+        next.buttons ^= value;
+      }
+      for (uint8_t i = 0; i < GamepadAxis::Count; ++i) {
+        if (flags & (1 << i)) {
+          if (!readVarint(p, end, value)) return false;
+          next.axes[i] += decodeZigzag(value);
+        }
+      }
+    }
+    if (p != end) {
+      return false;
+    }
+    if (hasKeyframe && sequence != nextSequence) {
+      ++countLost;
+      hasKeyframe = false;
+    }
+    nextSequence = sequence + 1;
+    if (flags & StateTelemetryFlag::Keyframe) {
+      hasKeyframe = true;
+    } else if (!hasKeyframe) {
+      return true;  // the delta applies to an unknown state
+    }
+    current = next;
+    return true;
+  }
+};
+
+};  // namespace GamepadControllerESP32
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace GamepadControllerESP32 {
+
+static const size_t varintMaxLen = 5;
+
+// LEB128, 7 bits per byte from the lowest ones
+inline size_t writeVarint(uint32_t value, uint8_t* out) {
+  size_t len = 0;
+  while (value >= 0x80) {
+    out[len++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[len++] = (uint8_t)value;
+  return len;
+}
+
+// Advances p, returns false when the data ends in the middle of the value
+inline bool readVarint(const uint8_t*& p, const uint8_t* end,
+                       uint32_t& value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (p >= end) {
+      return false;
+    }
+    uint8_t b = *p++;
+    value |= (uint32_t)(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Maps small negative and positive values to small unsigned ones
+inline uint32_t encodeZigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t decodeZigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+};  // namespace GamepadControllerESP32
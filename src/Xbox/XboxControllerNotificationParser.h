@@ -1,35 +1,34 @@
 #pragma once
 
-#include "GamepadNotificationParser.h"
+#include "LayoutControllerNotificationParser.hpp"
 
 namespace GamepadControllerESP32 {
 
-class XboxControllerNotificationParser : public GamepadControllerNotificationParser {
- public:
-  XboxControllerNotificationParser();
-
-  // bool btnA, btnB, btnX, btnY;
-  // bool btnShare, btnStart, btnSelect, btnHome;
-  // // side top button
-  // bool btnLB, btnRB;
-  // // button on joy stick
-  // bool btnLS, btnRS;
-  // bool btnDirUp, btnDirLeft, btnDirRight, btnDirDown;
-  // uint16_t joyLHori = maxJoy / 2;
-  // uint16_t joyLVert = maxJoy / 2;
-  // uint16_t joyRHori = maxJoy / 2;
-  // uint16_t joyRVert = maxJoy / 2;
-  // uint16_t trigLT, trigRT;
-  uint8_t update(uint8_t* data, size_t length);
-  uint8_t toArr(uint8_t* data, size_t length);
-  String toString();
-
-  static const size_t expectedDataLen = 16;
-  static const uint16_t maxJoy = 0xffff;
-  static const uint16_t maxTrig = 0x3ff;
+struct XboxReportLayout {
+  // clang-format off
+  static constexpr GamepadReportLayout layout = {
+    16, 0xffff, 0x3ff,
+    3, {
+      // from bit 0: A B _ X Y _ LB RB
+      {13, 0b11011011, 0},
+      // from bit 0: _ _ Select Start Xbox LS RS _
+      {14, 0b01111100, 8},
+      // Share
+      {15, 0b00000001, 15},
+    },
+    // hat value 0 (neutral) to 8 (up left) clockwise from up
+    12,
+    {0, 1, 3, 2, 6, 4, 12, 8, 9},
+    {0, 1, 3, 2, 5, 1, 4, 2, 7, 8, 3, 2, 6, 8, 4, 2},
+    {{0, 2}, {2, 2}, {4, 2}, {6, 2}, {8, 2}, {10, 2}},
+  };
+  // clang-format on
+};
 
- private:
-  static void convertU16TU8Arr(uint16_t vU16, uint8_t* data);
+class XboxControllerNotificationParser final
+    : public LayoutControllerNotificationParser<XboxReportLayout> {
+ public:
+  size_t format(char* buf, size_t len);
 };
 
 };  // namespace GamepadControllerESP32
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <AdvertisementFilter.hpp>
+
+using namespace GamepadControllerESP32;
+
+// flags, appearance 964, HID service and manufacturer data of xbox controllers
+static const uint8_t xboxPayload[] = {0x02, 0x01, 0x06, 0x03, 0x19, 0xc4,
+                                      0x03, 0x03, 0x03, 0x12, 0x18, 0x04,
+                                      0xff, 0x06, 0x00, 0x00};
+static const uint8_t searchingPayload[] = {
+    0x03, 0x19, 0xc4, 0x03, 0x03, 0x02, 0x12, 0x18,
+    0x06, 0xff, 0x06, 0x00, 0x03, 0x00, 0x80};
+// a heart rate sensor
+static const uint8_t otherPayload[] = {0x02, 0x01, 0x06, 0x03,
+                                       0x03, 0x0d, 0x18};
+
+// 44:16:22:01:02:03 and 44:16:22:aa:bb:cc in native order
+static const uint8_t xboxAddress[6] = {0x03, 0x02, 0x01, 0x22, 0x16, 0x44};
+static const uint8_t xboxAddress2[6] = {0xcc, 0xbb, 0xaa, 0x22, 0x16, 0x44};
+static const uint8_t otherAddress[6] = {0x03, 0x02, 0x01, 0x33, 0x33, 0x33};
+
+TEST(AdvertisementFilter, AcceptsControllersWithoutRules) {
+  AdvertisementFilter filter;
+  EXPECT_TRUE(filter.isTarget(otherAddress, xboxPayload, sizeof(xboxPayload)));
+  EXPECT_TRUE(filter.isTarget(otherAddress, searchingPayload,
+                              sizeof(searchingPayload)));
+  EXPECT_FALSE(
+      filter.isTarget(xboxAddress, otherPayload, sizeof(otherPayload)));
+  EXPECT_EQ(3u, filter.getCountSeen());
+  EXPECT_EQ(1u, filter.getCountRejected());
+}
+
+TEST(AdvertisementFilter, RejectsBrokenPayloads) {
+  AdvertisementFilter filter;
+  EXPECT_FALSE(filter.isTarget(xboxAddress, xboxPayload, 0));
+  // the manufacturer data is cut
+  EXPECT_FALSE(
+      filter.isTarget(xboxAddress, xboxPayload, sizeof(xboxPayload) - 1));
+  uint8_t payload[sizeof(xboxPayload)];
+  memcpy(payload, xboxPayload, sizeof(payload));
+  payload[5] = 0xc3;  // appearance 963, a keyboard
+  EXPECT_FALSE(filter.isTarget(xboxAddress, payload, sizeof(payload)));
+}
+
+TEST(AdvertisementFilter, RequiresTheSignatureForOuiRules) {
+  static const GamepadAddressRule rules[] = {
+      {{0x44, 0x16, 0x22}, true},
+  };
+  AdvertisementFilter filter;
+  filter.setAddressRules(rules, 1);
+  EXPECT_TRUE(filter.isTarget(xboxAddress, xboxPayload, sizeof(xboxPayload)));
+  EXPECT_TRUE(
+      filter.isTarget(xboxAddress2, xboxPayload, sizeof(xboxPayload)));
+  EXPECT_FALSE(
+      filter.isTarget(xboxAddress, otherPayload, sizeof(otherPayload)));
+  EXPECT_FALSE(
+      filter.isTarget(otherAddress, xboxPayload, sizeof(xboxPayload)));
+}
+
+TEST(AdvertisementFilter, MatchesFullAddressesByAddressOnly) {
+  static const GamepadAddressRule rules[] = {
+      {{0x44, 0x16, 0x22, 0x01, 0x02, 0x03}, false},
+  };
+  AdvertisementFilter filter;
+  filter.setAddressRules(rules, 1);
+  EXPECT_TRUE(
+      filter.isTarget(xboxAddress, otherPayload, sizeof(otherPayload)));
+  EXPECT_FALSE(
+      filter.isTarget(xboxAddress2, xboxPayload, sizeof(xboxPayload)));
+}
+
+TEST(AdvertisementFilter, MatchesTheTargetAddressOnly) {
+  AdvertisementFilter filter;
+  filter.setTargetAddress(xboxAddress2);
+  EXPECT_TRUE(filter.isTarget(xboxAddress2, nullptr, 0));
+  EXPECT_FALSE(filter.isTarget(xboxAddress, xboxPayload, sizeof(xboxPayload)));
+
+  static const GamepadAddressRule rules[] = {
+      {{0x33, 0x33, 0x33}, true},
+  };
+  filter.setAddressRules(rules, 1);
+  EXPECT_TRUE(filter.isTarget(xboxAddress2, nullptr, 0));
+  EXPECT_TRUE(
+      filter.isTarget(otherAddress, xboxPayload, sizeof(xboxPayload)));
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include <AxisNormalizer.hpp>
+#include <CenterTracker.hpp>
+
+#include <stdlib.h>
+
+#include "ReportCorpus.hpp"
+
+using namespace GamepadControllerESP32;
+
+static const uint16_t xboxMaxJoy = 0xffff;
+static const uint16_t xboxMaxTrig = 0x3ff;
+
+static GamepadState buildState(uint16_t lHori, uint16_t lVert,
+                               uint16_t trigger = 0) {
+  GamepadState state;
+  state.reset(xboxMaxJoy / 2);
+  state.axes[GamepadAxis::LHori] = lHori;
+  state.axes[GamepadAxis::LVert] = lVert;
+  state.axes[GamepadAxis::LT] = trigger;
+  return state;
+}
+
+static NormalizedGamepadState normalize(const AxisNormalizer& normalizer,
+                                        const GamepadState& state) {
+  NormalizedGamepadState out;
+  EXPECT_TRUE(normalizer.normalize(state, out));
+  return out;
+}
+
+TEST(AxisNormalizer, NeedsARange) {
+  AxisNormalizer normalizer;
+  NormalizedGamepadState out;
+  EXPECT_FALSE(normalizer.normalize(buildState(0, 0), out));
+}
+
+TEST(AxisNormalizer, MapsTheFullRange) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  uint16_t center = xboxMaxJoy / 2;
+  auto out = normalize(normalizer, buildState(0, center, xboxMaxTrig));
+  EXPECT_EQ(-q15One, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LVert]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::RHori]);
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LT]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::RT]);
+  out = normalize(normalizer, buildState(center, xboxMaxJoy));
+  EXPECT_EQ(0, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LVert]);
+
+  GamepadState half = buildState(center + 0x4000, center);
+  half.axes[GamepadAxis::LT] = (xboxMaxTrig + 1) / 2;
+  out = normalize(normalizer, half);
+  EXPECT_NEAR(q15One / 2, out.axes[GamepadAxis::LHori], 2);
+  EXPECT_NEAR(q15One / 2, out.axes[GamepadAxis::LT], 32);
+}
+
+TEST(AxisNormalizer, ReachesBothEndsFromAnOffCenter) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(0x80, 0xff);
+  normalizer.setCenter(GamepadAxis::LHori, 0x50);
+  GamepadState state = buildState(0x50, 0x40);
+  EXPECT_EQ(0, normalize(normalizer, state).axes[GamepadAxis::LHori]);
+  state.axes[GamepadAxis::LHori] = 0;
+  EXPECT_EQ(-q15One, normalize(normalizer, state).axes[GamepadAxis::LHori]);
+  state.axes[GamepadAxis::LHori] = 0x80;
+  EXPECT_EQ(q15One, normalize(normalizer, state).axes[GamepadAxis::LHori]);
+}
+
+TEST(AxisNormalizer, TreatsMissingRangesAsZero) {
+  AxisNormalizer normalizer;
+  // a generic controller without triggers
+  normalizer.setRange(0xff, 0);
+  GamepadState state = buildState(0xff, 0xff / 2, 0x200);
+  auto out = normalize(normalizer, state);
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LT]);
+
+  // triggers only
+  normalizer.setRange(0, 0xff);
+  state.axes[GamepadAxis::LT] = 0xff;
+  out = normalize(normalizer, state);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LT]);
+}
+
+TEST(AxisNormalizer, KeepsCentersForTheSameStickRange) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  normalizer.setCenter(GamepadAxis::RVert, 0x8100);
+  normalizer.setRange(xboxMaxJoy, 0);
+  EXPECT_EQ(0x8100, normalizer.getCenter(GamepadAxis::RVert));
+  EXPECT_EQ(0, normalizer.getMaxTrig());
+  normalizer.setRange(0x80, 0xff);
+  EXPECT_EQ(0x40, normalizer.getCenter(GamepadAxis::RVert));
+  normalizer.setCenter(GamepadAxis::RVert, 0x41);
+  normalizer.resetCenters();
+  EXPECT_EQ(0x40, normalizer.getCenter(GamepadAxis::RVert));
+}
+
+TEST(AxisNormalizer, CalibratesCentersFromARestingState) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  GamepadState rest = buildState(0x8300, 0x7c00);
+  normalizer.calibrateCenter(rest);
+  EXPECT_EQ(0x8300, normalizer.getCenter(GamepadAxis::LHori));
+  auto out = normalize(normalizer, rest);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LVert]);
+}
+
+TEST(AxisNormalizer, AppliesARadialDeadzone) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  normalizer.setStickDeadzone(q15One / 10);
+  uint16_t center = xboxMaxJoy / 2;
+  // 7% on both axes is 9.9% from the center, inside
+  auto out = normalize(normalizer, buildState(center + 0x900, center + 0x900));
+  EXPECT_EQ(0, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LVert]);
+  // 8% on both axes is 11.3% from the center, outside, still diagonal
+  out = normalize(normalizer, buildState(center + 0xa40, center + 0xa40));
+  EXPECT_GT(out.axes[GamepadAxis::LHori], 0);
+  EXPECT_LT(out.axes[GamepadAxis::LHori], q15One / 20);
+  EXPECT_EQ(out.axes[GamepadAxis::LHori], out.axes[GamepadAxis::LVert]);
+  // corners of the square stick come back to the circle
+  out = normalize(normalizer, buildState(xboxMaxJoy, 0));
+  int32_t x = out.axes[GamepadAxis::LHori];
+  int32_t y = out.axes[GamepadAxis::LVert];
+  EXPECT_NEAR(q15One, sqrt((double)x * x + (double)y * y), 4);
+  EXPECT_EQ(x, -y);
+  out = normalize(normalizer, buildState(xboxMaxJoy, center));
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LHori]);
+}
+
+TEST(AxisNormalizer, AppliesAnAxialDeadzone) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  normalizer.setStickDeadzone(q15One / 10, DeadzoneMode::Axial);
+  normalizer.setTriggerDeadzone(q15One / 4);
+  uint16_t center = xboxMaxJoy / 2;
+  auto out = normalize(normalizer,
+                       buildState(center + 0x2000, center + 0x900, 0xff));
+  EXPECT_GT(out.axes[GamepadAxis::LHori], 0);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LVert]);
+  EXPECT_EQ(0, out.axes[GamepadAxis::LT]);
+  out = normalize(normalizer, buildState(0, center, xboxMaxTrig));
+  EXPECT_EQ(-q15One, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LT]);
+}
+
+TEST(AxisNormalizer, FollowsTheResponseCurve) {
+  uint16_t curve[AxisNormalizer::curvePoints];
+  AxisNormalizer::buildPowerCurve(curve, 2);
+  EXPECT_EQ(0, curve[0]);
+  EXPECT_EQ(q15One, curve[AxisNormalizer::curvePoints - 1]);
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  normalizer.setStickCurve(curve);
+  normalizer.setTriggerCurve(curve);
+  uint16_t center = xboxMaxJoy / 2;
+  auto out = normalize(normalizer, buildState(center + 0x4000, center,
+                                              (xboxMaxTrig + 1) / 2));
+  EXPECT_NEAR(q15One / 4, out.axes[GamepadAxis::LHori], 64);
+  EXPECT_NEAR(q15One / 4, out.axes[GamepadAxis::LT], 64);
+  out = normalize(normalizer, buildState(xboxMaxJoy, center, xboxMaxTrig));
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(q15One, out.axes[GamepadAxis::LT]);
+}
+
+TEST(StickCenters, AppliesOnlyToTheSameRange) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  normalizer.setCenter(GamepadAxis::LHori, 0x8400);
+  StickCenters centers;
+  centers.readFrom(normalizer);
+
+  AxisNormalizer other;
+  other.setRange(0x80, 0xff);
+  EXPECT_FALSE(centers.applyTo(other));
+  EXPECT_EQ(0x40, other.getCenter(GamepadAxis::LHori));
+  other.setRange(xboxMaxJoy, xboxMaxTrig);
+  EXPECT_TRUE(centers.applyTo(other));
+  EXPECT_EQ(0x8400, other.getCenter(GamepadAxis::LHori));
+
+  StickCenters moved = centers;
+  EXPECT_FALSE(moved.differsFrom(centers));
+  moved.centers[GamepadAxis::LHori] += xboxMaxJoy / 256;
+  EXPECT_FALSE(moved.differsFrom(centers));
+  moved.centers[GamepadAxis::LHori] += 1;
+  EXPECT_TRUE(moved.differsFrom(centers));
+}
+
+TEST(CenterTracker, FollowsARestingStick) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  CenterTracker tracker;
+  ReportCorpus::Random random(3);
+  uint16_t rest = xboxMaxJoy / 2 + 0x600;
+  for (int i = 0; i < 2000; ++i) {
+    GamepadState state = buildState(rest + random.below(5) - 2,
+                                    xboxMaxJoy / 2 + random.below(5) - 2);
+    tracker.update(state, normalizer);
+  }
+  EXPECT_NEAR(rest, normalizer.getCenter(GamepadAxis::LHori), 4);
+  EXPECT_NEAR(xboxMaxJoy / 2, normalizer.getCenter(GamepadAxis::LVert), 4);
+  EXPECT_GT(tracker.getCountRestingReport(), 1000u);
+}
+
+TEST(CenterTracker, IgnoresHeldAndMovingSticks) {
+  AxisNormalizer normalizer;
+  normalizer.setRange(xboxMaxJoy, xboxMaxTrig);
+  CenterTracker tracker;
+  uint16_t center = xboxMaxJoy / 2;
+  // held far from the center
+  for (int i = 0; i < 1000; ++i) {
+    tracker.update(buildState(center + 0x3000, center), normalizer);
+  }
+  EXPECT_EQ(center, normalizer.getCenter(GamepadAxis::LHori));
+  // moving near the center
+  for (int i = 0; i < 1000; ++i) {
+    uint16_t offset = i % 2 == 0 ? 0x600 : 0;
+    tracker.update(buildState(center + offset, center), normalizer);
+  }
+  EXPECT_EQ(center, normalizer.getCenter(GamepadAxis::LHori));
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// The hand-written xbox and Newgame decoders and encoders the layouts
+// replaced, kept as the reference the layout parsers are compared to
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace BaselineParsers {
+
+struct Fields {
+  bool btnA, btnB, btnX, btnY;
+  bool btnShare, btnStart, btnSelect, btnHome;
+  bool btnLB, btnRB;
+  bool btnLS, btnRS;
+  bool btnDirUp, btnDirLeft, btnDirRight, btnDirDown;
+  uint16_t joyLHori, joyLVert, joyRHori, joyRVert;
+  uint16_t trigLT, trigRT;
+};
+
+inline void decodeMainButtons(uint8_t btnBits, Fields& f) {
+  f.btnA = btnBits & 0b00000001;
+  f.btnB = btnBits & 0b00000010;
+  f.btnX = btnBits & 0b00001000;
+  f.btnY = btnBits & 0b00010000;
+  f.btnLB = btnBits & 0b01000000;
+  f.btnRB = btnBits & 0b10000000;
+}
+
+inline uint8_t encodeMainButtons(const Fields& f) {
+  uint8_t btnBits = 0;
+  if (f.btnA) btnBits |= 0b00000001;
+  if (f.btnB) btnBits |= 0b00000010;
+  if (f.btnX) btnBits |= 0b00001000;
+  if (f.btnY) btnBits |= 0b00010000;
+  if (f.btnLB) btnBits |= 0b01000000;
+  if (f.btnRB) btnBits |= 0b10000000;
+  return btnBits;
+}
+
+inline void decodeXbox(const uint8_t* data, Fields& f) {
+  f = Fields();
+  decodeMainButtons(data[13], f);
+  uint8_t btnBits = data[14];
+  f.btnSelect = btnBits & 0b00000100;
+  f.btnStart = btnBits & 0b00001000;
+  f.btnHome = btnBits & 0b00010000;
+  f.btnLS = btnBits & 0b00100000;
+  f.btnRS = btnBits & 0b01000000;
+  f.btnShare = data[15] & 0b00000001;
+  btnBits = data[12];
+  f.btnDirUp = btnBits == 1 || btnBits == 2 || btnBits == 8;
+  f.btnDirRight = 2 <= btnBits && btnBits <= 4;
+  f.btnDirDown = 4 <= btnBits && btnBits <= 6;
+  f.btnDirLeft = 6 <= btnBits && btnBits <= 8;
+  f.joyLHori = data[0] | (data[1] << 8);
+  f.joyLVert = data[2] | (data[3] << 8);
+  f.joyRHori = data[4] | (data[5] << 8);
+  f.joyRVert = data[6] | (data[7] << 8);
+  f.trigLT = data[8] | (data[9] << 8);
+  f.trigRT = data[10] | (data[11] << 8);
+}
+
+inline void encodeXbox(const Fields& f, uint8_t* data) {
+  const uint16_t axes[] = {f.joyLHori, f.joyLVert, f.joyRHori,
+                           f.joyRVert, f.trigLT,   f.trigRT};
+  for (int i = 0; i < 6; ++i) {
+    data[i * 2] = axes[i] & 0xff;
+    data[i * 2 + 1] = axes[i] >> 8;
+  }
+  data[13] = encodeMainButtons(f);
+  uint8_t btnBits = 0;
+  if (f.btnSelect) btnBits |= 0b00000100;
+  if (f.btnStart) btnBits |= 0b00001000;
+  if (f.btnHome) btnBits |= 0b00010000;
+  if (f.btnLS) btnBits |= 0b00100000;
+  if (f.btnRS) btnBits |= 0b01000000;
+  data[14] = btnBits;
+  data[15] = f.btnShare ? 1 : 0;
+  if (f.btnDirUp) {
+    data[12] = f.btnDirRight ? 2 : f.btnDirLeft ? 8 : 1;
+  } else if (f.btnDirDown) {
+    data[12] = f.btnDirRight ? 4 : f.btnDirLeft ? 6 : 5;
+  } else {
+    data[12] = f.btnDirRight ? 3 : f.btnDirLeft ? 7 : 0;
+  }
+}
+
+inline void decodeNewgame(const uint8_t* data, Fields& f) {
+  f = Fields();
+  decodeMainButtons(data[5], f);
+  uint8_t btnBits = data[6];
+  f.btnStart = btnBits & 0b00001000;
+  f.btnLS = btnBits & 0b00000001;
+  f.btnRS = btnBits & 0b00000010;
+  btnBits = data[4];
+  f.btnDirUp = btnBits <= 1 || btnBits == 7;
+  f.btnDirRight = 1 <= btnBits && btnBits <= 3;
+  f.btnDirDown = 3 <= btnBits && btnBits <= 5;
+  f.btnDirLeft = 5 <= btnBits && btnBits <= 7;
+  f.joyLHori = data[0];
+  f.joyLVert = data[1];
+  f.joyRHori = data[2];
+  f.joyRVert = data[3];
+  f.trigLT = data[7];
+  f.trigRT = data[8];
+}
+
+// Byte 6 was overwritten by the zeroed share byte, so Start, LS and RS
+// were never encoded
+inline void encodeNewgame(const Fields& f, uint8_t* data) {
+  data[0] = f.joyLHori;
+  data[1] = f.joyLVert;
+  data[2] = f.joyRHori;
+  data[3] = f.joyRVert;
+  data[7] = f.trigLT;
+  data[8] = f.trigRT;
+  data[5] = encodeMainButtons(f);
+  data[6] = 0;
+  if (f.btnDirUp) {
+    data[4] = f.btnDirRight ? 1 : f.btnDirLeft ? 7 : 0;
+  } else if (f.btnDirDown) {
+    data[4] = f.btnDirRight ? 3 : f.btnDirLeft ? 5 : 4;
+  } else {
+    data[4] = f.btnDirRight ? 2 : f.btnDirLeft ? 6 : 0xf;
+  }
+}
+
+};  // namespace BaselineParsers
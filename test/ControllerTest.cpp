@@ -0,0 +1,645 @@
+#include <gtest/gtest.h>
+
+#include <GamepadControllerESP32.hpp>
+
+#include <vector>
+
+#include "ReportCorpus.hpp"
+
+using namespace GamepadControllerESP32;
+
+typedef BasicGamepadController<XboxControllerNotificationParser> XboxController;
+
+// Services of an xbox series controller: battery level, input report 1,
+// output report 3 and the report map
+class XboxPeripheral : public FakePeripheral {
+ public:
+  static const uint16_t handleInput = 0x1e;
+  static const uint16_t handleOutput = 0x22;
+
+  explicit XboxPeripheral(const std::string& address)
+      : FakePeripheral(address) {
+    setXboxAdvertisement();
+    pCharaBattery =
+        addCharacteristic("180f", "2a19", 0x0b,
+                          FakeProperty::Read | FakeProperty::Notify,
+                          std::string(1, 100));
+    pCharaMap = addCharacteristic(
+        "1812", "2a4b", 0x14, FakeProperty::Read,
+        std::string((const char*)ReportCorpus::xboxReportMap,
+                    sizeof(ReportCorpus::xboxReportMap)));
+    pCharaInput = addCharacteristic("1812", "2a4d", handleInput,
+                                    FakeProperty::Read | FakeProperty::Notify);
+    pCharaOutput = addCharacteristic(
+        "1812", "2a4d", handleOutput,
+        FakeProperty::Read | FakeProperty::Write |
+            FakeProperty::WriteNoResponse);
+    FakeNimBLE::addPeripheral(*this);
+  }
+
+  NimBLERemoteCharacteristic* pCharaBattery;
+  NimBLERemoteCharacteristic* pCharaMap;
+  NimBLERemoteCharacteristic* pCharaInput;
+  NimBLERemoteCharacteristic* pCharaOutput;
+
+  bool notifyInput(const uint8_t* data) {
+    return notify(pCharaInput, data, ReportCorpus::xboxReportLen);
+  }
+  bool notifyBattery(uint8_t level) {
+    return notify(pCharaBattery, &level, 1);
+  }
+};
+const uint16_t XboxPeripheral::handleInput;
+const uint16_t XboxPeripheral::handleOutput;
+
+// Keeps what the controller writes
+class BufferPrint : public Print {
+ public:
+  using Print::write;
+  std::vector<uint8_t> bytes;
+  size_t write(uint8_t c) {
+    bytes.push_back(c);
+    return 1;
+  }
+};
+
+static void buildReport(uint16_t lHori, uint16_t lVert, uint8_t buttonMain,
+                        uint8_t* data) {
+  memset(data, 0, ReportCorpus::xboxReportLen);
+  ReportCorpus::writeU16(lHori, &data[0]);
+  ReportCorpus::writeU16(lVert, &data[2]);
+  ReportCorpus::writeU16(0x8000, &data[4]);
+  ReportCorpus::writeU16(0x8000, &data[6]);
+  data[13] = buttonMain;
+}
+
+class ControllerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FakeNimBLE::reset();
+    FakeTasks::reset();
+    FakePreferences::reset();
+    FakeClock::reset();
+  }
+
+  // Scan, advertisement and connection up to the first notification
+  template <typename Controller>
+  static void connectByScan(Controller& controller,
+                            XboxPeripheral& peripheral) {
+    controller.onLoop();
+    ASSERT_TRUE(NimBLEDevice::getScan()->isScanning());
+    ASSERT_TRUE(FakeNimBLE::advertise(peripheral));
+    controller.onLoop();
+    ASSERT_TRUE(controller.isConnecting());
+    FakeTasks::runReady();
+    ASSERT_TRUE(controller.isWaitingForFirstNotification());
+  }
+};
+
+TEST_F(ControllerTest, ConnectsAFoundController) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.begin();
+  EXPECT_EQ(1u, FakeTasks::getCount());
+  EXPECT_EQ(ConnectionState::Scanning, controller.getConnectionState());
+
+  controller.onLoop();
+  EXPECT_EQ(1u, NimBLEDevice::getScan()->getCountStart());
+  ASSERT_TRUE(FakeNimBLE::advertise(peripheral));
+  EXPECT_EQ(ConnectionState::Found, controller.getConnectionState());
+  // the connection runs in the task, onLoop() only requests it
+  controller.onLoop();
+  EXPECT_EQ(ConnectionState::Connecting, controller.getConnectionState());
+  EXPECT_EQ(nullptr, peripheral.getClient());
+  EXPECT_EQ(1, FakeTasks::runReady());
+  ASSERT_NE(nullptr, peripheral.getClient());
+  EXPECT_TRUE(controller.isWaitingForFirstNotification());
+  EXPECT_TRUE(peripheral.pCharaInput->isSubscribed());
+  EXPECT_TRUE(peripheral.pCharaBattery->isSubscribed());
+  EXPECT_EQ(3u, peripheral.getClient()->getConnectTimeoutSec());
+  EXPECT_EQ(251, peripheral.getClient()->getDataLen());
+  EXPECT_STREQ("44:16:22:01:02:03",
+               controller.buildDeviceAddressStr().c_str());
+
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0xffff, 0x8000, 0x01, data);
+  ASSERT_TRUE(peripheral.notifyInput(data));
+  EXPECT_EQ(ConnectionState::Connected, controller.getConnectionState());
+  GamepadState state;
+  ASSERT_TRUE(controller.getSnapshot(state));
+  EXPECT_EQ(0xffff, state.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(GamepadButton::A, state.buttons);
+  EXPECT_TRUE(controller.gamepadNotif->btnA);
+  EXPECT_EQ(GamepadButton::A, controller.consumeButtonEdges().pressed);
+
+  ASSERT_TRUE(peripheral.notifyBattery(87));
+  EXPECT_EQ(87, controller.battery);
+  // the battery level is not a report
+  ASSERT_TRUE(controller.getSnapshot(state));
+  EXPECT_EQ(GamepadButton::A, state.buttons);
+
+  ConnectionStatus status;
+  ASSERT_TRUE(controller.getConnectionStatus(status));
+  EXPECT_EQ(7500u, status.intervalUs);
+  EXPECT_EQ(1000, status.timeoutMs);
+}
+
+TEST_F(ControllerTest, IgnoresOtherDevices) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  peripheral.advertisement = {0x02, 0x01, 0x06, 0x03, 0x03, 0x0d, 0x18};
+  XboxController controller;
+  controller.begin();
+  controller.onLoop();
+  ASSERT_TRUE(FakeNimBLE::advertise(peripheral));
+  EXPECT_EQ(ConnectionState::Scanning, controller.getConnectionState());
+  controller.onLoop();
+  EXPECT_EQ(0, FakeTasks::runReady());
+  EXPECT_EQ(nullptr, peripheral.getClient());
+  EXPECT_EQ(1u, controller.getCountAdvertRejected());
+}
+
+TEST_F(ControllerTest, DisconnectsAndScansAgain) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.begin();
+  connectByScan(controller, peripheral);
+  peripheral.disconnect();
+  EXPECT_FALSE(controller.isConnected());
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x8000, 0x8000, 0, data);
+  XboxHIDReportBuilder::XboxReportBase repo;
+  controller.writeHIDReport(repo);
+  EXPECT_EQ(0u, peripheral.pCharaOutput->countWrite);
+
+  FakeNimBLE::endScan();
+  // the remembered address first, then a scan
+  controller.onLoop();
+  EXPECT_TRUE(controller.isConnecting());
+  peripheral.isConnectable = false;
+  FakeTasks::runReady();
+  EXPECT_EQ(ConnectionState::Scanning, controller.getConnectionState());
+  EXPECT_EQ(0, controller.getCountFailedConnection());
+  controller.onLoop();
+  EXPECT_TRUE(NimBLEDevice::getScan()->isScanning());
+}
+
+TEST_F(ControllerTest, ReconnectsTheRememberedPeerWithoutScanning) {
+  {
+    XboxPeripheral peripheral("44:16:22:01:02:03");
+    XboxController controller;
+    controller.begin();
+    connectByScan(controller, peripheral);
+    EXPECT_TRUE(FakePreferences::has("gamepadCtrl", "peer"));
+  }
+  // restart of the device, NVS is kept
+  FakeNimBLE::reset();
+  FakeTasks::reset();
+  uint32_t countPut = FakePreferences::getCountPut();
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.begin();
+  controller.onLoop();
+  EXPECT_TRUE(controller.isConnecting());
+  FakeTasks::runReady();
+  EXPECT_TRUE(controller.isWaitingForFirstNotification());
+  EXPECT_EQ(0u, NimBLEDevice::getScan()->getCountStart());
+  // the same address is not written again
+  EXPECT_EQ(countPut, FakePreferences::getCountPut());
+
+  controller.forgetPeer();
+  EXPECT_FALSE(FakePreferences::has("gamepadCtrl", "peer"));
+}
+
+TEST_F(ControllerTest, ConnectsOnlyTheTargetAddress) {
+  XboxPeripheral other("44:16:22:01:02:03");
+  XboxPeripheral target("44:16:22:0a:0b:0c");
+  XboxController controller("44:16:22:0a:0b:0c");
+  controller.begin();
+  // the target is tried before scanning, it is not in range yet
+  target.isConnectable = false;
+  controller.onLoop();
+  FakeTasks::runReady();
+  controller.onLoop();
+  ASSERT_TRUE(NimBLEDevice::getScan()->isScanning());
+  ASSERT_TRUE(FakeNimBLE::advertise(other));
+  EXPECT_EQ(ConnectionState::Scanning, controller.getConnectionState());
+  target.isConnectable = true;
+  ASSERT_TRUE(FakeNimBLE::advertise(target));
+  controller.onLoop();
+  FakeTasks::runReady();
+  EXPECT_TRUE(controller.isWaitingForFirstNotification());
+  EXPECT_NE(nullptr, target.getClient());
+  // the target is not written to NVS
+  EXPECT_FALSE(FakePreferences::has("gamepadCtrl", "peer"));
+}
+
+TEST_F(ControllerTest, DeletesTheBondAfterFailedConnections) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  peripheral.countFailingConnect = 1000;
+  XboxController controller;
+  controller.begin();
+  controller.onLoop();
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(0u, FakeNimBLE::getCountDeleteBond());
+    ASSERT_TRUE(FakeNimBLE::advertise(peripheral));
+    controller.onLoop();
+    FakeTasks::runReady();
+    EXPECT_EQ(ConnectionState::Scanning, controller.getConnectionState());
+  }
+  EXPECT_EQ(1u, FakeNimBLE::getCountDeleteBond());
+  EXPECT_EQ(0, controller.getCountFailedConnection());
+  // a first try and 3 retries for each advertisement
+  EXPECT_EQ(12u, NimBLEDevice::getClientByID(0)->getCountConnect());
+  EXPECT_EQ(1u, NimBLEDevice::getClientListSize());
+
+  peripheral.countFailingConnect = 2;
+  ASSERT_TRUE(FakeNimBLE::advertise(peripheral));
+  controller.onLoop();
+  FakeTasks::runReady();
+  EXPECT_TRUE(controller.isWaitingForFirstNotification());
+  EXPECT_EQ(0, controller.getCountFailedConnection());
+}
+
+// A client created by one controller is reused by the next controller
+// connecting to the same address, which has to receive the callbacks
+TEST_F(ControllerTest, RebindsAReusedClient) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController first;
+  first.setRemembersPeer(false);
+  first.begin();
+  connectByScan(first, peripheral);
+  NimBLEClient* pClient = peripheral.getClient();
+  pClient->setConnectTimeout(30);
+  EXPECT_EQ(2u, peripheral.getCountDiscovery());
+  peripheral.disconnect();
+  FakeNimBLE::endScan();
+
+  XboxController second;
+  second.setRemembersPeer(false);
+  second.begin();
+  connectByScan(second, peripheral);
+  EXPECT_EQ(pClient, peripheral.getClient());
+  EXPECT_EQ(1u, NimBLEDevice::getClientListSize());
+  EXPECT_EQ(3u, pClient->getConnectTimeoutSec());
+  // the attributes are kept
+  EXPECT_EQ(2u, peripheral.getCountDiscovery());
+
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x1000, 0x8000, 0, data);
+  ASSERT_TRUE(peripheral.notifyInput(data));
+  EXPECT_TRUE(second.isConnected());
+  EXPECT_EQ(0x1000, second.gamepadNotif->joyLHori);
+  EXPECT_NE(0x1000, first.gamepadNotif->joyLHori);
+
+  peripheral.disconnect();
+  EXPECT_FALSE(second.isConnected());
+  EXPECT_EQ(ConnectionState::Scanning, second.getConnectionState());
+}
+
+TEST_F(ControllerTest, ReadsTheReportMapOncePerAddress) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  BasicGamepadController<GenericControllerNotificationParser> controller;
+  controller.setRemembersPeer(false);
+  controller.begin();
+  connectByScan(controller, peripheral);
+  EXPECT_EQ(1u, peripheral.pCharaMap->countRead);
+  EXPECT_EQ(0xffff, controller.gamepadNotif->getMaxJoy());
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x1234, 0x8000, 0x02, data);
+  ASSERT_TRUE(peripheral.notifyInput(data));
+  EXPECT_EQ(0x1234, controller.gamepadNotif->joyLHori);
+  EXPECT_TRUE(controller.gamepadNotif->btnB);
+
+  peripheral.disconnect();
+  ASSERT_TRUE(FakeNimBLE::advertise(peripheral));
+  controller.onLoop();
+  FakeTasks::runReady();
+  EXPECT_TRUE(controller.isWaitingForFirstNotification());
+  EXPECT_EQ(1u, peripheral.pCharaMap->countRead);
+}
+
+TEST_F(ControllerTest, SuppressesDuplicateReports) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.setSuppressesDuplicates(true);
+  controller.begin();
+  connectByScan(controller, peripheral);
+  uint32_t countSnapshot = controller.getSnapshotCount();
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x8000, 0x8000, 0x01, data);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(peripheral.notifyInput(data));
+  }
+  EXPECT_EQ(countSnapshot + 1, controller.getSnapshotCount());
+  EXPECT_EQ(4u, controller.getCountSuppressedReport());
+  data[13] = 0;
+  ASSERT_TRUE(peripheral.notifyInput(data));
+  EXPECT_EQ(countSnapshot + 2, controller.getSnapshotCount());
+  ButtonEdges edges = controller.consumeButtonEdges();
+  EXPECT_EQ(GamepadButton::A, edges.pressed);
+  EXPECT_EQ(GamepadButton::A, edges.released);
+}
+
+// A resting stick repeats its report, which the change filter drops
+TEST_F(ControllerTest, TracksCentersFromSuppressedReports) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.setSuppressesDuplicates(true);
+  controller.setTracksCenter(true);
+  controller.begin();
+  connectByScan(controller, peripheral);
+  uint32_t countSnapshot = controller.getSnapshotCount();
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x8000 + 0x600, 0x8000, 0, data);
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(peripheral.notifyInput(data));
+  }
+  EXPECT_EQ(countSnapshot + 1, controller.getSnapshotCount());
+  EXPECT_EQ(1999u, controller.getCountSuppressedReport());
+  EXPECT_NEAR(0x8600, controller.getAxisNormalizer().getCenter(
+                          GamepadAxis::LHori), 4);
+}
+
+TEST_F(ControllerTest, WritesOutputReports) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.begin();
+  connectByScan(controller, peripheral);
+  XboxHIDReportBuilder::XboxReportBase repo;
+  repo.v.power.left = 30;
+  controller.writeHIDReport(repo);
+  ASSERT_EQ(1u, peripheral.pCharaOutput->countWrite);
+  EXPECT_EQ(std::vector<uint8_t>(repo.arr8t, repo.arr8t + repo.arr8tLen),
+            peripheral.pCharaOutput->writtenValue);
+
+  // scheduled reports are written from onLoop()
+  repo.v.power.left = 60;
+  controller.scheduleHIDReport(repo);
+  EXPECT_EQ(1u, peripheral.pCharaOutput->countWrite);
+  controller.onLoop();
+  ASSERT_EQ(2u, peripheral.pCharaOutput->countWrite);
+  EXPECT_EQ(std::vector<uint8_t>(repo.arr8t, repo.arr8t + repo.arr8tLen),
+            peripheral.pCharaOutput->writtenValue);
+}
+
+// HID over GATT tells the report type in the Report Reference descriptor
+TEST_F(ControllerTest, WritesTheReportReferencedAsOutput) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  // a writable feature report before the output report
+  NimBLERemoteCharacteristic* pCharaFeature = peripheral.addCharacteristic(
+      "1812", "2a4d", XboxPeripheral::handleInput - 4,
+      FakeProperty::Read | FakeProperty::Write);
+  pCharaFeature->addDescriptor("2908", std::string("\x04\x03", 2));
+  peripheral.pCharaInput->addDescriptor("2908", std::string("\x01\x01", 2));
+  peripheral.pCharaOutput->addDescriptor("2908",
+                                         std::string("\x03\x02", 2));
+  XboxController controller;
+  controller.begin();
+  connectByScan(controller, peripheral);
+  XboxHIDReportBuilder::XboxReportBase repo;
+  controller.writeHIDReport(repo);
+  EXPECT_EQ(0u, pCharaFeature->countWrite);
+  EXPECT_EQ(1u, peripheral.pCharaOutput->countWrite);
+}
+
+TEST_F(ControllerTest, CapturesFromOnLoopOnly) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.begin();
+  connectByScan(controller, peripheral);
+  BufferPrint out;
+  controller.startCapture(out);
+  size_t headerLen = out.bytes.size();
+  ASSERT_NE(0u, headerLen);
+
+  auto reports = ReportCorpus::buildXboxSession(20);
+  for (auto& report : reports) {
+    FakeClock::advanceUs(8000);
+    ASSERT_TRUE(peripheral.notifyInput(report.data));
+  }
+  // nothing is written from the notification callback
+  EXPECT_EQ(headerLen, out.bytes.size());
+  controller.onLoop();
+  EXPECT_LT(headerLen, out.bytes.size());
+  controller.stopCapture();
+
+  ReportCaptureReader reader;
+  ASSERT_TRUE(reader.begin(out.bytes.data(), out.bytes.size()));
+  CapturedReport captured;
+  for (auto& report : reports) {
+    ASSERT_TRUE(reader.next(captured));
+    EXPECT_EQ(XboxPeripheral::handleInput, captured.reportId);
+    EXPECT_EQ(0, memcmp(report.data, captured.data, captured.length));
+  }
+  EXPECT_FALSE(reader.next(captured));
+  EXPECT_EQ(0u, controller.getCountCaptureDropped());
+}
+
+TEST_F(ControllerTest, SavesMovedCentersFromTheConnectionTask) {
+  XboxPeripheral peripheral("44:16:22:01:02:03");
+  XboxController controller;
+  controller.setTracksCenter(true);
+  controller.begin();
+  connectByScan(controller, peripheral);
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x8000 + 0x600, 0x8000, 0, data);
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(peripheral.notifyInput(data));
+  }
+  EXPECT_NEAR(0x8600, controller.getAxisNormalizer().getCenter(
+                          GamepadAxis::LHori), 4);
+
+  uint32_t countPut = FakePreferences::getCountPut();
+  controller.onLoop();
+  // rate limited
+  EXPECT_EQ(0, FakeTasks::runReady());
+  FakeClock::advanceMs(60000);
+  controller.onLoop();
+  EXPECT_EQ(countPut, FakePreferences::getCountPut());
+  EXPECT_FALSE(FakePreferences::has("gamepadCtrl", "c441622010203"));
+  EXPECT_EQ(1, FakeTasks::runReady());
+  EXPECT_EQ(countPut + 1, FakePreferences::getCountPut());
+  EXPECT_TRUE(FakePreferences::has("gamepadCtrl", "c441622010203"));
+  // unchanged since
+  FakeClock::advanceMs(60000);
+  controller.onLoop();
+  EXPECT_EQ(0, FakeTasks::runReady());
+
+  // the saved centers come back at the next connection
+  peripheral.disconnect();
+  XboxController next;
+  next.setTracksCenter(true);
+  next.setRemembersPeer(false);
+  next.begin();
+  FakeNimBLE::endScan();
+  connectByScan(next, peripheral);
+  buildReport(0x8600, 0x8000, 0, data);
+  ASSERT_TRUE(peripheral.notifyInput(data));
+  EXPECT_NEAR(0x8600, next.getAxisNormalizer().getCenter(GamepadAxis::LHori),
+              4);
+  NormalizedGamepadState normalized;
+  ASSERT_TRUE(next.getNormalizedSnapshot(normalized));
+  EXPECT_NEAR(0, normalized.axes[GamepadAxis::LHori], 4);
+}
+
+TEST_F(ControllerTest, ResetsCentersForAControllerWithoutSavedOnes) {
+  XboxPeripheral first("44:16:22:01:02:03");
+  XboxPeripheral second("44:16:22:0a:0b:0c");
+  XboxController controller;
+  controller.setTracksCenter(true);
+  controller.setRemembersPeer(false);
+  controller.begin();
+  connectByScan(controller, first);
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x8000 + 0x600, 0x8000, 0, data);
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(first.notifyInput(data));
+  }
+  ASSERT_NE(0xffff / 2,
+            controller.getAxisNormalizer().getCenter(GamepadAxis::LHori));
+
+  first.disconnect();
+  ASSERT_TRUE(FakeNimBLE::advertise(second));
+  controller.onLoop();
+  FakeTasks::runReady();
+  ASSERT_TRUE(controller.isWaitingForFirstNotification());
+  buildReport(0x8000, 0x8000, 0, data);
+  ASSERT_TRUE(second.notifyInput(data));
+  EXPECT_EQ(0xffff / 2,
+            controller.getAxisNormalizer().getCenter(GamepadAxis::LHori));
+}
+
+TEST_F(ControllerTest, HubConnectsOnePadPerController) {
+  XboxPeripheral first("44:16:22:01:02:03");
+  XboxPeripheral second("44:16:22:0a:0b:0c");
+  BasicGamepadHub<XboxControllerNotificationParser, 2> hub;
+  hub.begin();
+  EXPECT_EQ(1u, FakeTasks::getCount());
+  hub.onLoop();
+  ASSERT_TRUE(NimBLEDevice::getScan()->isScanning());
+  ASSERT_TRUE(FakeNimBLE::advertise(first));
+  // advertised again before the connection
+  ASSERT_TRUE(FakeNimBLE::advertise(first));
+  ASSERT_TRUE(FakeNimBLE::advertise(second));
+  hub.onLoop();
+  EXPECT_FALSE(NimBLEDevice::getScan()->isScanning());
+  EXPECT_TRUE(hub.getPad(0).isConnecting());
+  EXPECT_TRUE(hub.getPad(1).isConnecting());
+  EXPECT_EQ(1, FakeTasks::runReady());
+  EXPECT_EQ(2u, hub.getCountConnected());
+  EXPECT_EQ(2u, NimBLEDevice::getClientListSize());
+
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x1000, 0x8000, 0x01, data);
+  ASSERT_TRUE(first.notifyInput(data));
+  buildReport(0x2000, 0x8000, 0x02, data);
+  ASSERT_TRUE(second.notifyInput(data));
+  EXPECT_EQ(0x1000, hub.getPad(0).gamepadNotif->joyLHori);
+  EXPECT_TRUE(hub.getPad(0).gamepadNotif->btnA);
+  EXPECT_EQ(0x2000, hub.getPad(1).gamepadNotif->joyLHori);
+  EXPECT_TRUE(hub.getPad(1).gamepadNotif->btnB);
+
+  // no free pad, no scan
+  hub.onLoop();
+  EXPECT_FALSE(NimBLEDevice::getScan()->isScanning());
+  second.disconnect();
+  hub.onLoop();
+  EXPECT_TRUE(NimBLEDevice::getScan()->isScanning());
+  EXPECT_EQ(1u, hub.getCountConnected());
+}
+
+// NimBLE waits for its events on the task notification, so a request of
+// another pad must not wake the connection task through it
+TEST_F(ControllerTest, HubKeepsReadingWhenAnotherPadRequests) {
+  XboxPeripheral first("44:16:22:01:02:03");
+  XboxPeripheral second("44:16:22:0a:0b:0c");
+  BasicGamepadHub<XboxControllerNotificationParser, 2> hub;
+  hub.begin();
+  hub.onLoop();
+  ASSERT_TRUE(FakeNimBLE::advertise(first));
+  hub.onLoop();
+  ASSERT_TRUE(hub.getPad(0).isConnecting());
+  bool hasRequested = false;
+  first.onWait = [&]() {
+    // a read after the connection
+    if (hasRequested || first.getClient() == nullptr) {
+      return;
+    }
+    hasRequested = true;
+    ASSERT_TRUE(FakeNimBLE::advertiseLate(second));
+    hub.onLoop();
+    EXPECT_TRUE(hub.getPad(1).isConnecting());
+  };
+  EXPECT_EQ(1, FakeTasks::runReady());
+  EXPECT_TRUE(hasRequested);
+  EXPECT_EQ(0u, first.getCountEarlyWake());
+  EXPECT_EQ(2u, hub.getCountConnected());
+}
+
+TEST_F(ControllerTest, HubConnectsAPadRequestedWhileAnotherConnects) {
+  XboxPeripheral first("44:16:22:01:02:03");
+  XboxPeripheral second("44:16:22:0a:0b:0c");
+  BasicGamepadHub<XboxControllerNotificationParser, 2> hub;
+  hub.begin();
+  hub.onLoop();
+  ASSERT_TRUE(FakeNimBLE::advertise(first));
+  hub.onLoop();
+  bool hasRequested = false;
+  first.onWait = [&]() {
+    // the connection itself
+    if (hasRequested || first.getClient() != nullptr) {
+      return;
+    }
+    hasRequested = true;
+    ASSERT_TRUE(FakeNimBLE::advertiseLate(second));
+    hub.onLoop();
+    EXPECT_TRUE(hub.getPad(0).isConnecting());
+    EXPECT_TRUE(hub.getPad(1).isConnecting());
+  };
+  EXPECT_EQ(1, FakeTasks::runReady());
+  EXPECT_TRUE(hasRequested);
+  EXPECT_EQ(0u, first.getCountEarlyWake());
+  EXPECT_EQ(1u, first.getClient()->getCountConnect());
+  EXPECT_TRUE(hub.getPad(0).isWaitingForFirstNotification());
+  EXPECT_TRUE(hub.getPad(1).isWaitingForFirstNotification());
+  // each request ran once
+  EXPECT_EQ(1u, second.getClient()->getCountConnect());
+  EXPECT_EQ(0, FakeTasks::runReady());
+}
+
+TEST_F(ControllerTest, HubSavesCentersRequestedWhileAnotherPadConnects) {
+  XboxPeripheral first("44:16:22:01:02:03");
+  XboxPeripheral second("44:16:22:0a:0b:0c");
+  BasicGamepadHub<XboxControllerNotificationParser, 2> hub;
+  hub.getPad(0).setTracksCenter(true);
+  hub.begin();
+  hub.onLoop();
+  ASSERT_TRUE(FakeNimBLE::advertise(first));
+  hub.onLoop();
+  FakeTasks::runReady();
+  ASSERT_TRUE(hub.getPad(0).isWaitingForFirstNotification());
+  uint8_t data[ReportCorpus::xboxReportLen];
+  buildReport(0x8000 + 0x600, 0x8000, 0, data);
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(first.notifyInput(data));
+  }
+
+  hub.onLoop();
+  ASSERT_TRUE(FakeNimBLE::advertise(second));
+  hub.onLoop();
+  ASSERT_TRUE(hub.getPad(1).isConnecting());
+  bool hasRequested = false;
+  second.onWait = [&]() {
+    if (hasRequested) {
+      return;
+    }
+    hasRequested = true;
+    FakeClock::advanceMs(60000);
+    hub.onLoop();
+  };
+  EXPECT_EQ(1, FakeTasks::runReady());
+  EXPECT_TRUE(hasRequested);
+  EXPECT_EQ(0u, second.getCountEarlyWake());
+  EXPECT_TRUE(hub.getPad(1).isWaitingForFirstNotification());
+  EXPECT_TRUE(FakePreferences::has("gamepadCtrl", "c441622010203"));
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <Generic/GenericControllerNotificationParser.h>
+#include <HIDReportMap.h>
+#include <Xbox/XboxControllerNotificationParser.h>
+
+#include "ReportCorpus.hpp"
+
+using namespace GamepadControllerESP32;
+
+TEST(HIDReportPlan, ParsesTheXboxMap) {
+  HIDReportPlan plan;
+  ASSERT_TRUE(plan.parse(ReportCorpus::xboxReportMap,
+                         sizeof(ReportCorpus::xboxReportMap)));
+  EXPECT_EQ(1, plan.reportId);
+  EXPECT_EQ(ReportCorpus::xboxReportLen, plan.dataLen);
+  EXPECT_EQ(0xffff, plan.maxJoy);
+  EXPECT_EQ(0x3ff, plan.maxTrig);
+  EXPECT_TRUE(plan.isValid());
+}
+
+TEST(HIDReportPlan, RejectsMapsWithoutGamepad) {
+  // a keyboard: Generic Desktop / Keyboard
+  const uint8_t map[] = {0x05, 0x01, 0x09, 0x06, 0xa1, 0x01, 0x05, 0x07,
+                         0x19, 0xe0, 0x29, 0xe7, 0x15, 0x00, 0x25, 0x01,
+                         0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0xc0};
+  HIDReportPlan plan;
+  EXPECT_FALSE(plan.parse(map, sizeof(map)));
+  EXPECT_FALSE(plan.parse(ReportCorpus::xboxReportMap, 10));
+}
+
+TEST(HIDReportPlan, DecodesLikeTheXboxParser) {
+  HIDReportPlan plan;
+  ASSERT_TRUE(plan.parse(ReportCorpus::xboxReportMap,
+                         sizeof(ReportCorpus::xboxReportMap)));
+  XboxControllerNotificationParser xbox;
+  ReportCorpus::Random random(56);
+  for (int k = 0; k < 20000; ++k) {
+    uint8_t data[ReportCorpus::xboxReportLen];
+    ReportCorpus::fillRandomXboxReport(random, data);
+    GamepadState state;
+    ASSERT_EQ(0, plan.decode(data, sizeof(data), state));
+    ASSERT_EQ(0, xbox.update(data, sizeof(data)));
+    ASSERT_EQ(xbox.state, state) << "report " << k;
+
+    uint8_t encoded[ReportCorpus::xboxReportLen] = {};
+    ASSERT_EQ(0, plan.encode(state, encoded, sizeof(encoded)));
+    ASSERT_EQ(0, memcmp(data, encoded, sizeof(encoded))) << "report " << k;
+  }
+}
+
+TEST(HIDReportPlan, RejectsOtherLengths) {
+  HIDReportPlan plan;
+  ASSERT_TRUE(plan.parse(ReportCorpus::xboxReportMap,
+                         sizeof(ReportCorpus::xboxReportMap)));
+  uint8_t data[ReportCorpus::xboxReportLen + 1] = {};
+  GamepadState state;
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH,
+            plan.decode(data, ReportCorpus::xboxReportLen - 1, state));
+}
+
+TEST(GenericParser, NeedsAMap) {
+  GenericControllerNotificationParser parser;
+  uint8_t data[ReportCorpus::xboxReportLen] = {};
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_NO_REPORT_MAP,
+            parser.update(data, sizeof(data)));
+  EXPECT_EQ(nullptr, parser.getPlan());
+  EXPECT_EQ(0, parser.getMaxJoy());
+}
+
+TEST(GenericParser, LoadsTheCachedPlanOfAnAddress) {
+  const uint8_t address[6] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+  const uint8_t unknownAddress[6] = {0x11};
+  GenericControllerNotificationParser first;
+  ASSERT_TRUE(first.parseReportMap(address, ReportCorpus::xboxReportMap,
+                                   sizeof(ReportCorpus::xboxReportMap)));
+  EXPECT_EQ(0xffff / 2, first.joyLHori);
+
+  GenericControllerNotificationParser second;
+  EXPECT_FALSE(second.loadCachedReportMap(unknownAddress));
+  ASSERT_TRUE(second.loadCachedReportMap(address));
+  EXPECT_EQ(0xffff, second.getMaxJoy());
+  EXPECT_EQ(0x3ff, second.getMaxTrig());
+}
+
+// A connected pad keeps its plan when other pads replace every cache entry
+TEST(GenericParser, KeepsItsPlanWhenTheCacheIsReplaced) {
+  const uint8_t address[6] = {0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5};
+  GenericControllerNotificationParser parser;
+  ASSERT_TRUE(parser.loadCachedReportMap(address) ||
+              parser.parseReportMap(address, ReportCorpus::xboxReportMap,
+                                    sizeof(ReportCorpus::xboxReportMap)));
+  const HIDReportPlan* plan = parser.getPlan();
+
+  // another map with 8 bit sticks and no triggers
+  const uint8_t smallMap[] = {
+      0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x15, 0x00, 0x26, 0xff, 0x00,
+      0x75, 0x08, 0x95, 0x02, 0x09, 0x30, 0x09, 0x31, 0x81, 0x02, 0x05,
+      0x09, 0x19, 0x01, 0x29, 0x08, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01,
+      0x95, 0x08, 0x81, 0x02, 0xc0};
+  for (uint8_t i = 0; i < 4; ++i) {
+    const uint8_t otherAddress[6] = {i};
+    GenericControllerNotificationParser other;
+    ASSERT_TRUE(
+        other.parseReportMap(otherAddress, smallMap, sizeof(smallMap)));
+    EXPECT_EQ(0xff, other.getMaxJoy());
+  }
+
+  EXPECT_EQ(plan, parser.getPlan());
+  EXPECT_EQ(0xffff, parser.getMaxJoy());
+  ReportCorpus::Random random(78);
+  uint8_t data[ReportCorpus::xboxReportLen];
+  ReportCorpus::fillRandomXboxReport(random, data);
+  XboxControllerNotificationParser xbox;
+  ASSERT_EQ(0, xbox.update(data, sizeof(data)));
+  ASSERT_EQ(0, parser.update(data, sizeof(data)));
+  EXPECT_EQ(xbox.state, parser.state);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <HapticEffectPlayer.hpp>
+
+using namespace GamepadControllerESP32;
+using XboxHIDReportBuilder::InfoPower;
+using XboxHIDReportBuilder::XboxReportBase;
+
+static HapticKeyframe keyframe(uint16_t atMs, uint8_t left,
+                               uint8_t shape = HapticShape::Step,
+                               uint8_t pulseActive = 0,
+                               uint8_t pulseSilent = 0) {
+  HapticKeyframe keyframe = {atMs, {left, 0, 0, 0}, shape, pulseActive,
+                             pulseSilent};
+  return keyframe;
+}
+
+TEST(HapticEffectPlayer, RejectsInvalidEffects) {
+  HapticEffectPlayer player;
+  const HapticKeyframe single[] = {keyframe(0, 50)};
+  EXPECT_FALSE(player.start({single, 1}, 0));
+  const HapticKeyframe late[] = {keyframe(10, 50), keyframe(100, 0)};
+  EXPECT_FALSE(player.start({late, 2}, 0));
+  const HapticKeyframe unordered[] = {keyframe(0, 50), keyframe(100, 0),
+                                      keyframe(100, 0)};
+  EXPECT_FALSE(player.start({unordered, 3}, 0));
+  EXPECT_FALSE(player.isPlaying());
+  XboxReportBase repo;
+  EXPECT_FALSE(player.update(0, repo));
+}
+
+TEST(HapticEffectPlayer, WritesOneReportPerStep) {
+  const HapticKeyframe keyframes[] = {keyframe(0, 50), keyframe(500, 0)};
+  const HapticEffect effect = {keyframes, 2};
+  HapticEffectPlayer player;
+  XboxReportBase repo;
+  ASSERT_TRUE(player.start(effect, 1000));
+  ASSERT_TRUE(player.update(1000, repo));
+  EXPECT_TRUE(repo.v.select.left);
+  EXPECT_FALSE(repo.v.select.right);
+  EXPECT_EQ(50, repo.v.power.left);
+  EXPECT_EQ(50, repo.v.timeActive);
+  EXPECT_EQ(0, repo.v.countRepeat);
+  EXPECT_FALSE(player.update(1200, repo));
+  EXPECT_FALSE(player.update(1500, repo));
+  EXPECT_FALSE(player.isPlaying());
+}
+
+TEST(HapticEffectPlayer, SkipsSilentSteps) {
+  const HapticKeyframe keyframes[] = {keyframe(0, 0), keyframe(100, 80),
+                                      keyframe(300, 0)};
+  const HapticEffect effect = {keyframes, 3};
+  HapticEffectPlayer player;
+  XboxReportBase repo;
+  ASSERT_TRUE(player.start(effect, 0));
+  EXPECT_FALSE(player.update(0, repo));
+  EXPECT_FALSE(player.update(99, repo));
+  ASSERT_TRUE(player.update(100, repo));
+  EXPECT_EQ(80, repo.v.power.left);
+  EXPECT_EQ(20, repo.v.timeActive);
+}
+
+TEST(HapticEffectPlayer, SplitsRamps) {
+  const HapticKeyframe keyframes[] = {keyframe(0, 0, HapticShape::Ramp),
+                                      keyframe(200, 100)};
+  const HapticEffect effect = {keyframes, 2};
+  HapticEffectPlayer player;
+  XboxReportBase repo;
+  ASSERT_TRUE(player.start(effect, 0));
+  const uint8_t expected[] = {0, 25, 50, 75};
+  for (uint8_t i = 0; i < sizeof(expected); ++i) {
+    if (i != 0) {
+      EXPECT_FALSE(player.update(i * 50 - 1, repo));
+    }
+    ASSERT_TRUE(player.update(i * 50, repo));
+    EXPECT_EQ(expected[i], repo.v.power.left);
+    EXPECT_EQ(5, repo.v.timeActive);
+  }
+  EXPECT_FALSE(player.update(200, repo));
+  EXPECT_FALSE(player.isPlaying());
+}
+
+TEST(HapticEffectPlayer, RepeatsPulsesInOneReport) {
+  const HapticKeyframe keyframes[] = {
+      keyframe(0, 100, HapticShape::Pulse, 10, 10), keyframe(1100, 0)};
+  const HapticEffect effect = {keyframes, 2};
+  HapticEffectPlayer player;
+  XboxReportBase repo;
+  ASSERT_TRUE(player.start(effect, 0));
+  ASSERT_TRUE(player.update(0, repo));
+  EXPECT_EQ(100, repo.v.power.left);
+  EXPECT_EQ(10, repo.v.timeActive);
+  EXPECT_EQ(10, repo.v.timeSilent);
+  EXPECT_EQ(4, repo.v.countRepeat);
+  // the last 100 ms are shorter than a period
+  EXPECT_FALSE(player.update(999, repo));
+  ASSERT_TRUE(player.update(1000, repo));
+  EXPECT_EQ(10, repo.v.timeActive);
+  EXPECT_EQ(0, repo.v.countRepeat);
+  EXPECT_FALSE(player.update(1100, repo));
+}
+
+TEST(HapticEffectPlayer, TurnsMotorsOffOnStop) {
+  const HapticKeyframe keyframes[] = {keyframe(0, 60), keyframe(2000, 0)};
+  const HapticEffect effect = {keyframes, 2};
+  HapticEffectPlayer player;
+  XboxReportBase repo;
+  ASSERT_TRUE(player.start(effect, 0));
+  ASSERT_TRUE(player.update(0, repo));
+  player.stop();
+  EXPECT_TRUE(player.isPlaying());
+  ASSERT_TRUE(player.update(10, repo));
+  EXPECT_FALSE(repo.v.select.left);
+  EXPECT_EQ(0, repo.v.power.left);
+  EXPECT_FALSE(player.isPlaying());
+  EXPECT_FALSE(player.update(20, repo));
+}
@@ -0,0 +1,179 @@
+// Host counterpart of examples/benchmark: the parsers and the per-report
+// helpers over the report corpus of the tests, in ns per report.
+
+#include <benchmark/benchmark.h>
+
+#include <HIDReportMap.h>
+#include <Newgame/NewgameControllerNotificationParser.h>
+#include <ReportCapture.hpp>
+#include <StateTelemetry.hpp>
+#include <Xbox/XboxControllerNotificationParser.h>
+
+#include <vector>
+
+#include "ReportCorpus.hpp"
+
+using namespace GamepadControllerESP32;
+
+static const size_t countSessionReport = 4096;
+
+static const std::vector<ReportCorpus::TimedReport>& getXboxSession() {
+  static const std::vector<ReportCorpus::TimedReport> session =
+      ReportCorpus::buildXboxSession(countSessionReport);
+  return session;
+}
+
+static const std::vector<std::vector<uint8_t>>& getNewgameReports() {
+  static std::vector<std::vector<uint8_t>> reports;
+  if (reports.empty()) {
+    ReportCorpus::Random random(12);
+    for (size_t k = 0; k < countSessionReport; ++k) {
+      std::vector<uint8_t> data(ReportCorpus::newgameReportLen);
+      ReportCorpus::fillRandomNewgameReport(random, data.data());
+      reports.push_back(data);
+    }
+  }
+  return reports;
+}
+
+static std::vector<GamepadState> buildXboxStates() {
+  std::vector<GamepadState> states;
+  XboxControllerNotificationParser parser;
+  for (auto& report : getXboxSession()) {
+    uint8_t data[ReportCorpus::xboxReportLen];
+    memcpy(data, report.data, sizeof(data));
+    parser.update(data, sizeof(data));
+    states.push_back(parser.state);
+  }
+  return states;
+}
+
+// Runs body on each report of the session in turn
+template <typename Body>
+static void runOverXboxSession(benchmark::State& state, Body body) {
+  // update() takes non-const data
+  std::vector<ReportCorpus::TimedReport> session = getXboxSession();
+  size_t k = 0;
+  for (auto _ : state) {
+    body(session[k].data);
+    k = (k + 1) % session.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_XboxUpdate(benchmark::State& state) {
+  XboxControllerNotificationParser parser;
+  runOverXboxSession(state, [&](uint8_t* data) {
+    parser.update(data, ReportCorpus::xboxReportLen);
+    benchmark::DoNotOptimize(parser.state);
+  });
+}
+BENCHMARK(BM_XboxUpdate);
+
+static void BM_XboxToArr(benchmark::State& state) {
+  auto states = buildXboxStates();
+  XboxControllerNotificationParser parser;
+  uint8_t arr[ReportCorpus::xboxReportLen];
+  size_t k = 0;
+  for (auto _ : state) {
+    parser.state = states[k];
+    parser.toArr(arr, sizeof(arr));
+    benchmark::DoNotOptimize(arr);
+    k = (k + 1) % states.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_XboxToArr);
+
+static void BM_XboxRoundTrip(benchmark::State& state) {
+  XboxControllerNotificationParser parser;
+  uint8_t arr[ReportCorpus::xboxReportLen];
+  runOverXboxSession(state, [&](uint8_t* data) {
+    parser.update(data, ReportCorpus::xboxReportLen);
+    parser.toArr(arr, sizeof(arr));
+    benchmark::DoNotOptimize(arr);
+  });
+}
+BENCHMARK(BM_XboxRoundTrip);
+
+static void BM_XboxFormat(benchmark::State& state) {
+  XboxControllerNotificationParser parser;
+  char buf[gamepadStateFormatMaxLen];
+  runOverXboxSession(state, [&](uint8_t* data) {
+    parser.update(data, ReportCorpus::xboxReportLen);
+    benchmark::DoNotOptimize(parser.format(buf, sizeof(buf)));
+  });
+}
+BENCHMARK(BM_XboxFormat);
+
+static void BM_XboxToString(benchmark::State& state) {
+  XboxControllerNotificationParser parser;
+  runOverXboxSession(state, [&](uint8_t* data) {
+    parser.update(data, ReportCorpus::xboxReportLen);
+    String str = parser.toString();
+    benchmark::DoNotOptimize(str.c_str());
+  });
+}
+BENCHMARK(BM_XboxToString);
+
+static void BM_ReportPlanDecode(benchmark::State& state) {
+  HIDReportPlan plan;
+  plan.parse(ReportCorpus::xboxReportMap, sizeof(ReportCorpus::xboxReportMap));
+  GamepadState decoded;
+  runOverXboxSession(state, [&](uint8_t* data) {
+    plan.decode(data, ReportCorpus::xboxReportLen, decoded);
+    benchmark::DoNotOptimize(decoded);
+  });
+}
+BENCHMARK(BM_ReportPlanDecode);
+
+static void BM_NewgameRoundTrip(benchmark::State& state) {
+  auto reports = getNewgameReports();
+  NewgameControllerNotificationParser parser;
+  uint8_t arr[ReportCorpus::newgameReportLen];
+  size_t k = 0;
+  for (auto _ : state) {
+    parser.update(reports[k].data(), reports[k].size());
+    parser.toArr(arr, sizeof(arr));
+    benchmark::DoNotOptimize(arr);
+    k = (k + 1) % reports.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NewgameRoundTrip);
+
+static void BM_CaptureWrite(benchmark::State& state) {
+  auto session = getXboxSession();
+  ReportCaptureWriter writer;
+  uint8_t record[ReportCaptureWriter::maxRecordLen];
+  size_t k = 0;
+  size_t len = 0;
+  for (auto _ : state) {
+    auto& report = session[k];
+    len += writer.write(report.timestampUs, 30, report.data,
+                        sizeof(report.data), record);
+    benchmark::DoNotOptimize(record);
+    k = (k + 1) % session.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["bytes/report"] = (double)len / state.iterations();
+}
+BENCHMARK(BM_CaptureWrite);
+
+static void BM_TelemetryEncode(benchmark::State& state) {
+  auto states = buildXboxStates();
+  StateTelemetryEncoder encoder;
+  uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+  size_t k = 0;
+  size_t len = 0;
+  for (auto _ : state) {
+    len += encoder.encode(states[k], frame);
+    benchmark::DoNotOptimize(frame);
+    k = (k + 1) % states.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["bytes/report"] = (double)len / state.iterations();
+}
+BENCHMARK(BM_TelemetryEncode);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include <Newgame/NewgameControllerNotificationParser.h>
+#include <Xbox/XboxControllerNotificationParser.h>
+
+#include "BaselineParsers.hpp"
+#include "ReportCorpus.hpp"
+
+using namespace GamepadControllerESP32;
+
+static BaselineParsers::Fields readFields(
+    const GamepadControllerNotificationParser& parser) {
+  BaselineParsers::Fields f;
+  f.btnA = parser.btnA;
+  f.btnB = parser.btnB;
+  f.btnX = parser.btnX;
+  f.btnY = parser.btnY;
+  f.btnShare = parser.btnShare;
+  f.btnStart = parser.btnStart;
+  f.btnSelect = parser.btnSelect;
+  f.btnHome = parser.btnHome;
+  f.btnLB = parser.btnLB;
+  f.btnRB = parser.btnRB;
+  f.btnLS = parser.btnLS;
+  f.btnRS = parser.btnRS;
+  f.btnDirUp = parser.btnDirUp;
+  f.btnDirLeft = parser.btnDirLeft;
+  f.btnDirRight = parser.btnDirRight;
+  f.btnDirDown = parser.btnDirDown;
+  f.joyLHori = parser.joyLHori;
+  f.joyLVert = parser.joyLVert;
+  f.joyRHori = parser.joyRHori;
+  f.joyRVert = parser.joyRVert;
+  f.trigLT = parser.trigLT;
+  f.trigRT = parser.trigRT;
+  return f;
+}
+
+static bool operator==(const BaselineParsers::Fields& a,
+                       const BaselineParsers::Fields& b) {
+  return a.btnA == b.btnA && a.btnB == b.btnB && a.btnX == b.btnX &&
+         a.btnY == b.btnY && a.btnShare == b.btnShare &&
+         a.btnStart == b.btnStart && a.btnSelect == b.btnSelect &&
+         a.btnHome == b.btnHome && a.btnLB == b.btnLB && a.btnRB == b.btnRB &&
+         a.btnLS == b.btnLS && a.btnRS == b.btnRS &&
+         a.btnDirUp == b.btnDirUp && a.btnDirLeft == b.btnDirLeft &&
+         a.btnDirRight == b.btnDirRight && a.btnDirDown == b.btnDirDown &&
+         a.joyLHori == b.joyLHori && a.joyLVert == b.joyLVert &&
+         a.joyRHori == b.joyRHori && a.joyRVert == b.joyRVert &&
+         a.trigLT == b.trigLT && a.trigRT == b.trigRT;
+}
+
+TEST(XboxParser, DecodesAKnownReport) {
+  uint8_t data[] = {0x00, 0x80, 0xff, 0xff, 0x34, 0x12, 0x00, 0x00,
+                    0xff, 0x03, 0x00, 0x02, 0x02, 0x11, 0x48, 0x01};
+  XboxControllerNotificationParser parser;
+  ASSERT_EQ(0, parser.update(data, sizeof(data)));
+  EXPECT_EQ(0x8000, parser.state.axes[GamepadAxis::LHori]);
+  EXPECT_EQ(0xffff, parser.state.axes[GamepadAxis::LVert]);
+  EXPECT_EQ(0x1234, parser.state.axes[GamepadAxis::RHori]);
+  EXPECT_EQ(0, parser.state.axes[GamepadAxis::RVert]);
+  EXPECT_EQ(0x3ff, parser.state.axes[GamepadAxis::LT]);
+  EXPECT_EQ(0x200, parser.state.axes[GamepadAxis::RT]);
+  EXPECT_EQ(GamepadButton::A | GamepadButton::Y | GamepadButton::Start |
+                GamepadButton::RS | GamepadButton::Share |
+                GamepadButton::DirUp | GamepadButton::DirRight,
+            parser.state.buttons);
+  EXPECT_TRUE(parser.btnDirUp && parser.btnDirRight);
+  EXPECT_FALSE(parser.btnB || parser.btnDirDown || parser.btnDirLeft);
+}
+
+TEST(XboxParser, StartsCentered) {
+  XboxControllerNotificationParser parser;
+  EXPECT_EQ(0xffff / 2, parser.joyLHori);
+  EXPECT_EQ(0, parser.trigRT);
+  EXPECT_EQ(0u, parser.state.buttons);
+}
+
+TEST(XboxParser, RejectsOtherLengths) {
+  uint8_t data[17] = {1};
+  XboxControllerNotificationParser parser;
+  GamepadState before = parser.state;
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH, parser.update(data, 15));
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH, parser.update(data, 17));
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH, parser.toArr(data, 15));
+  EXPECT_EQ(before, parser.state);
+}
+
+TEST(XboxParser, MatchesTheHandWrittenParser) {
+  ReportCorpus::Random random(12);
+  XboxControllerNotificationParser parser;
+  for (int k = 0; k < 20000; ++k) {
+    uint8_t data[ReportCorpus::xboxReportLen];
+    ReportCorpus::fillRandomXboxReport(random, data);
+    BaselineParsers::Fields expected;
+    BaselineParsers::decodeXbox(data, expected);
+    ASSERT_EQ(0, parser.update(data, sizeof(data)));
+    ASSERT_TRUE(readFields(parser) == expected) << "report " << k;
+
+    uint8_t encoded[ReportCorpus::xboxReportLen];
+    uint8_t expectedEncoded[ReportCorpus::xboxReportLen];
+    ASSERT_EQ(0, parser.toArr(encoded, sizeof(encoded)));
+    BaselineParsers::encodeXbox(expected, expectedEncoded);
+    ASSERT_EQ(0, memcmp(expectedEncoded, encoded, sizeof(encoded)))
+        << "report " << k;
+  }
+}
+
+TEST(XboxParser, RoundTripsTheSession) {
+  XboxControllerNotificationParser parser;
+  for (auto& report : ReportCorpus::buildXboxSession(2000)) {
+    uint8_t data[ReportCorpus::xboxReportLen];
+    memcpy(data, report.data, sizeof(data));
+    ASSERT_EQ(0, parser.update(data, sizeof(data)));
+    uint8_t encoded[ReportCorpus::xboxReportLen];
+    ASSERT_EQ(0, parser.toArr(encoded, sizeof(encoded)));
+    ASSERT_EQ(0, memcmp(report.data, encoded, sizeof(encoded)));
+  }
+}
+
+TEST(NewgameParser, DecodesAKnownReport) {
+  uint8_t data[] = {0x00, 0x40, 0x80, 0x10, 0x05, 0x42, 0x0b, 0x7f, 0xff};
+  NewgameControllerNotificationParser parser;
+  ASSERT_EQ(0, parser.update(data, sizeof(data)));
+  EXPECT_EQ(0, parser.joyLHori);
+  EXPECT_EQ(0x40, parser.joyLVert);
+  EXPECT_EQ(0x80, parser.joyRHori);
+  EXPECT_EQ(0x10, parser.joyRVert);
+  EXPECT_EQ(0x7f, parser.trigLT);
+  EXPECT_EQ(0xff, parser.trigRT);
+  EXPECT_EQ(GamepadButton::B | GamepadButton::LB | GamepadButton::Start |
+                GamepadButton::LS | GamepadButton::RS |
+                GamepadButton::DirDown | GamepadButton::DirLeft,
+            parser.state.buttons);
+}
+
+TEST(NewgameParser, MatchesTheHandWrittenParser) {
+  ReportCorpus::Random random(34);
+  NewgameControllerNotificationParser parser;
+  for (int k = 0; k < 20000; ++k) {
+    uint8_t data[ReportCorpus::newgameReportLen];
+    ReportCorpus::fillRandomNewgameReport(random, data);
+    BaselineParsers::Fields expected;
+    BaselineParsers::decodeNewgame(data, expected);
+    ASSERT_EQ(0, parser.update(data, sizeof(data)));
+    ASSERT_TRUE(readFields(parser) == expected) << "report " << k;
+
+    // identical but byte 6, which now keeps Start, LS and RS
+    uint8_t encoded[ReportCorpus::newgameReportLen];
+    uint8_t expectedEncoded[ReportCorpus::newgameReportLen];
+    ASSERT_EQ(0, parser.toArr(encoded, sizeof(encoded)));
+    BaselineParsers::encodeNewgame(expected, expectedEncoded);
+    expectedEncoded[6] = data[6];
+    ASSERT_EQ(0, memcmp(expectedEncoded, encoded, sizeof(encoded)))
+        << "report " << k;
+  }
+}
+
+TEST(NewgameParser, RejectsOtherLengths) {
+  uint8_t data[16] = {};
+  NewgameControllerNotificationParser parser;
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH, parser.update(data, 16));
+  EXPECT_EQ(GAMEPAD_CONTROLLER_ERROR_INVALID_LENGTH, parser.toArr(data, 8));
+}
+
+TEST(Parser, FormatsWithoutAllocation) {
+  XboxControllerNotificationParser parser;
+  uint8_t data[ReportCorpus::xboxReportLen] = {};
+  data[13] = 0x01;
+  ASSERT_EQ(0, parser.update(data, sizeof(data)));
+  char buf[gamepadStateFormatMaxLen];
+  size_t len = parser.format(buf, sizeof(buf));
+  EXPECT_EQ(strlen(buf), len);
+  EXPECT_NE(nullptr, strstr(buf, "btnA: 1"));
+  EXPECT_NE(nullptr, strstr(buf, "btnXbox: 0"));
+  EXPECT_STREQ(buf, parser.toString().c_str());
+}
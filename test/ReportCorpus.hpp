@@ -0,0 +1,162 @@
+#pragma once
+
+// Reports shared by the tests and the benchmark. Sessions are generated from
+// a fixed seed, so every run sees the same bytes.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace ReportCorpus {
+
+// HID Report Map of an xbox series controller (input report 1 only)
+// clang-format off
+static const uint8_t xboxReportMap[] = {
+  0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x01, 0xa1, 0x00,
+  0x09, 0x30, 0x09, 0x31, 0x15, 0x00, 0x27, 0xff, 0xff, 0x00, 0x00, 0x95,
+  0x02, 0x75, 0x10, 0x81, 0x02, 0xc0, 0x09, 0x01, 0xa1, 0x00, 0x09, 0x32,
+  0x09, 0x35, 0x15, 0x00, 0x27, 0xff, 0xff, 0x00, 0x00, 0x95, 0x02, 0x75,
+  0x10, 0x81, 0x02, 0xc0, 0x05, 0x02, 0x09, 0xc5, 0x15, 0x00, 0x26, 0xff,
+  0x03, 0x95, 0x01, 0x75, 0x0a, 0x81, 0x02, 0x15, 0x00, 0x25, 0x00, 0x75,
+  0x06, 0x95, 0x01, 0x81, 0x03, 0x05, 0x02, 0x09, 0xc4, 0x15, 0x00, 0x26,
+  0xff, 0x03, 0x95, 0x01, 0x75, 0x0a, 0x81, 0x02, 0x15, 0x00, 0x25, 0x00,
+  0x75, 0x06, 0x95, 0x01, 0x81, 0x03, 0x05, 0x01, 0x09, 0x39, 0x15, 0x01,
+  0x25, 0x08, 0x35, 0x00, 0x46, 0x3b, 0x01, 0x66, 0x14, 0x00, 0x75, 0x04,
+  0x95, 0x01, 0x81, 0x42, 0x75, 0x04, 0x95, 0x01, 0x15, 0x00, 0x25, 0x00,
+  0x35, 0x00, 0x45, 0x00, 0x65, 0x00, 0x81, 0x03, 0x05, 0x09, 0x19, 0x01,
+  0x29, 0x0f, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0f, 0x81, 0x02,
+  0x15, 0x00, 0x25, 0x00, 0x75, 0x01, 0x95, 0x01, 0x81, 0x03, 0x05, 0x0c,
+  0x0a, 0xb2, 0x00, 0x15, 0x00, 0x25, 0x01, 0x95, 0x01, 0x75, 0x01, 0x81,
+  0x02, 0x15, 0x00, 0x25, 0x00, 0x75, 0x07, 0x95, 0x01, 0x81, 0x03, 0xc0,
+};
+// clang-format on
+
+static const size_t xboxReportLen = 16;
+static const size_t newgameReportLen = 9;
+
+struct TimedReport {
+  uint32_t timestampUs;
+  uint8_t data[xboxReportLen];
+};
+
+// Linear congruential generator, the same sequence on every host
+class Random {
+ public:
+  explicit Random(uint32_t seed) : value(seed) {}
+  uint32_t next() {
+    value = value * 1664525UL + 1013904223UL;
+    return value >> 8;
+  }
+  // 0 to range - 1
+  uint32_t below(uint32_t range) { return next() % range; }
+
+ private:
+  uint32_t value;
+};
+
+// Any byte values a controller can send: sticks and triggers anywhere in
+// their range, hat 0 to 8 and only the defined button bits
+inline void fillRandomXboxReport(Random& random, uint8_t* data) {
+  for (size_t i = 0; i < xboxReportLen; ++i) {
+    data[i] = random.next();
+  }
+  data[9] &= 0x03;
+  data[11] &= 0x03;
+  data[12] = random.below(9);
+  data[13] &= 0b11011011;
+  data[14] &= 0b01111100;
+  data[15] &= 0b00000001;
+}
+
+inline void fillRandomNewgameReport(Random& random, uint8_t* data) {
+  for (size_t i = 0; i < newgameReportLen; ++i) {
+    data[i] = random.next();
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    data[i] = random.below(0x81);
+  }
+  uint32_t hat = random.below(9);
+  data[4] = hat == 8 ? 0xf : hat;
+  data[5] &= 0b11011011;
+  data[6] &= 0b00001011;
+}
+
+inline void writeU16(uint16_t value, uint8_t* data) {
+  data[0] = value & 0xff;
+  data[1] = value >> 8;
+}
+
+// A play session of an xbox controller notifying every 8 ms: sticks resting
+// with sensor noise, sweeps of the left stick, trigger pulls and button
+// presses of 40 to 160 ms
+inline std::vector<TimedReport> buildXboxSession(size_t countReport,
+                                                 uint32_t seed = 1) {
+  Random random(seed);
+  std::vector<TimedReport> reports(countReport);
+  const uint16_t rest[4] = {0x8000 + 0x180, 0x8000 - 0x90, 0x7f40, 0x8060};
+  uint16_t sticks[4];
+  for (int i = 0; i < 4; ++i) sticks[i] = rest[i];
+  uint16_t triggers[2] = {0, 0};
+  uint8_t buttonMain = 0;
+  uint8_t hat = 0;
+  uint32_t buttonHeldCount = 0;
+  // 0 rest, 1 sweep of the left stick, 2 trigger pull
+  int phase = 0;
+  uint32_t phaseLeft = 0;
+  float angle = 0, speed = 0, radius = 0;
+  uint32_t timestampUs = 0;
+  for (size_t k = 0; k < countReport; ++k) {
+    if (phaseLeft == 0) {
+      phase = random.below(3);
+      phaseLeft = 60 + random.below(300);
+      angle = random.below(628) / 100.0f;
+      speed = (random.below(60) + 10) / 1000.0f;
+      radius = 0x2000 + random.below(0x5f00);
+    }
+    --phaseLeft;
+    for (int i = 0; i < 4; ++i) {
+      // noise of the sensors at rest
+      if (random.below(8) == 0) {
+        sticks[i] = rest[i] + (int)random.below(5) - 2;
+      }
+    }
+    if (phase == 1) {
+      angle += speed;
+      sticks[0] = 0x8000 + (int)(radius * cosf(angle));
+      sticks[1] = 0x8000 + (int)(radius * sinf(angle));
+    } else if (phase == 2) {
+      triggers[1] = triggers[1] + 24 > 0x3ff ? 0x3ff : triggers[1] + 24;
+    } else if (triggers[1] != 0) {
+      triggers[1] = triggers[1] < 48 ? 0 : triggers[1] - 48;
+    }
+    if (buttonHeldCount != 0) {
+      if (--buttonHeldCount == 0) {
+        buttonMain = 0;
+        hat = 0;
+      }
+    } else if (random.below(40) == 0) {
+      buttonHeldCount = 5 + random.below(15);
+      if (random.below(4) == 0) {
+        hat = 1 + random.below(8);
+      } else {
+        static const uint8_t bits[] = {0x01, 0x02, 0x08, 0x10, 0x40, 0x80};
+        buttonMain = bits[random.below(6)];
+      }
+    }
+    TimedReport& report = reports[k];
+    report.timestampUs = timestampUs;
+    for (int i = 0; i < 4; ++i) writeU16(sticks[i], &report.data[i * 2]);
+    writeU16(triggers[0], &report.data[8]);
+    writeU16(triggers[1], &report.data[10]);
+    report.data[12] = hat;
+    report.data[13] = buttonMain;
+    report.data[14] = 0;
+    report.data[15] = 0;
+    timestampUs += 7500 + random.below(1000);
+  }
+  return reports;
+}
+
+};  // namespace ReportCorpus
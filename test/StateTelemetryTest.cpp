@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <StateTelemetry.hpp>
+#include <Xbox/XboxControllerNotificationParser.h>
+
+#include <vector>
+
+#include "ReportCorpus.hpp"
+
+using namespace GamepadControllerESP32;
+
+static std::vector<GamepadState> buildStates(size_t count) {
+  std::vector<GamepadState> states;
+  XboxControllerNotificationParser parser;
+  for (auto& report : ReportCorpus::buildXboxSession(count)) {
+    parser.update(report.data, sizeof(report.data));
+    states.push_back(parser.state);
+  }
+  return states;
+}
+
+static GamepadState buildRestingState() {
+  GamepadState state;
+  state.reset(0x7fff);
+  return state;
+}
+
+TEST(Cobs, RoundTripsZeros) {
+  const uint8_t data[] = {0, 1, 0, 0, 2, 3, 0};
+  uint8_t encoded[sizeof(data) + 1];
+  size_t len = encodeCobs(data, sizeof(data), encoded);
+  ASSERT_EQ(sizeof(data) + 1, len);
+  for (size_t i = 0; i < len; ++i) {
+    EXPECT_NE(0, encoded[i]);
+  }
+  EXPECT_EQ(sizeof(data), decodeCobs(encoded, len));
+  EXPECT_EQ(0, memcmp(data, encoded, sizeof(data)));
+}
+
+TEST(Cobs, RejectsOverrunningCodes) {
+  uint8_t data[] = {5, 1, 2};
+  EXPECT_EQ(0u, decodeCobs(data, sizeof(data)));
+  uint8_t zero[] = {1, 0};
+  EXPECT_EQ(0u, decodeCobs(zero, sizeof(zero)));
+}
+
+TEST(Crc8, MatchesTheCheckValue) {
+  // CRC-8/SMBUS check value of "123456789"
+  const char* check = "123456789";
+  EXPECT_EQ(0xf4, computeCrc8((const uint8_t*)check, 9));
+}
+
+TEST(StateTelemetry, RebuildsEveryState) {
+  StateTelemetryEncoder encoder;
+  StateTelemetryDecoder decoder;
+  GamepadState received;
+  uint32_t countFrame = 0;
+  for (auto& state : buildStates(5000)) {
+    uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+    size_t len = encoder.encode(state, frame);
+    if (len == 0) {
+      continue;
+    }
+    ++countFrame;
+    for (size_t i = 0; i + 1 < len; ++i) {
+      ASSERT_NE(0, frame[i]);
+      ASSERT_FALSE(decoder.receive(frame[i], received));
+    }
+    ASSERT_TRUE(decoder.receive(frame[len - 1], received));
+    ASSERT_EQ(state, received);
+  }
+  EXPECT_EQ(countFrame, decoder.getCountFrame());
+  EXPECT_EQ(0u, decoder.getCountError());
+  EXPECT_EQ(0u, decoder.getCountLost());
+}
+
+TEST(StateTelemetry, SkipsUnchangedStates) {
+  StateTelemetryEncoder encoder(1000);
+  GamepadState state = buildRestingState();
+  uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+  EXPECT_NE(0u, encoder.encode(state, frame));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(0u, encoder.encode(state, frame));
+  }
+  encoder.requestKeyframe();
+  EXPECT_NE(0u, encoder.encode(state, frame));
+}
+
+// flags, sequence, one zigzag varint, CRC, COBS code and delimiter
+TEST(StateTelemetry, SendsOneAxisInSixOrSevenBytes) {
+  StateTelemetryEncoder encoder(1000);
+  GamepadState state = buildRestingState();
+  uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+  encoder.encode(state, frame);
+
+  state.axes[GamepadAxis::LHori] += 3;
+  EXPECT_EQ(6u, encoder.encode(state, frame));
+  state.axes[GamepadAxis::LHori] += 1000;
+  EXPECT_EQ(7u, encoder.encode(state, frame));
+  state.buttons ^= GamepadButton::A;
+  EXPECT_EQ(6u, encoder.encode(state, frame));
+}
+
+TEST(StateTelemetry, ResyncsAfterCorruptedBytes) {
+  StateTelemetryEncoder encoder(16);
+  StateTelemetryDecoder decoder;
+  ReportCorpus::Random random(90);
+  GamepadState received;
+  uint32_t countWrong = 0;
+  uint32_t countPublished = 0;
+  uint32_t countFrame = 0;
+  for (auto& state : buildStates(5000)) {
+    uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+    size_t len = encoder.encode(state, frame);
+    if (len != 0) {
+      ++countFrame;
+    }
+    for (size_t i = 0; i < len; ++i) {
+      uint8_t byte = frame[i];
+      // about one byte in 200 is flipped or lost
+      uint32_t noise = random.below(400);
+      if (noise == 0) {
+        byte ^= 1 << random.below(8);
+      } else if (noise == 1) {
+        continue;
+      }
+      if (decoder.receive(byte, received)) {
+        ++countPublished;
+        if (received != state) {
+          ++countWrong;
+        }
+      }
+    }
+  }
+  EXPECT_GT(decoder.getCountError() + decoder.getCountLost(), 0u);
+  // a lost frame costs the deltas up to the next keyframe
+  EXPECT_GT(countPublished, countFrame / 2);
+  EXPECT_EQ(0u, countWrong);
+  EXPECT_TRUE(decoder.hasState());
+}
+
+TEST(StateTelemetry, WaitsForAKeyframeAfterALostFrame) {
+  StateTelemetryEncoder encoder(8);
+  StateTelemetryDecoder decoder;
+  GamepadState state = buildRestingState();
+  GamepadState received;
+  auto send = [&](bool isLost) {
+    uint8_t frame[StateTelemetryEncoder::maxFrameLen];
+    size_t len = encoder.encode(state, frame);
+    bool isPublished = false;
+    for (size_t i = 0; i < len && !isLost; ++i) {
+      isPublished = decoder.receive(frame[i], received);
+    }
+    return isPublished;
+  };
+  EXPECT_TRUE(send(false));  // keyframe
+  state.axes[GamepadAxis::RT] = 10;
+  EXPECT_TRUE(send(false));
+  state.axes[GamepadAxis::RT] = 20;
+  send(true);
+  for (int i = 0; i < 5; ++i) {
+    state.axes[GamepadAxis::RT] += 10;
+    EXPECT_FALSE(send(false));
+  }
+  EXPECT_EQ(1u, decoder.getCountLost());
+  EXPECT_FALSE(decoder.hasState());
+  state.axes[GamepadAxis::RT] += 10;
+  EXPECT_TRUE(send(false));  // keyframe
+  EXPECT_EQ(state, received);
+}
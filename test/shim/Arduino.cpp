@@ -0,0 +1,185 @@
+#include "Arduino.h"
+
+#include <freertos/event_groups.h>
+
+#include <stdarg.h>
+
+#include <memory>
+#include <vector>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)buf,
+               (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+}
+
+static unsigned long long nowUs = 0;
+
+unsigned long millis() { return nowUs / 1000; }
+unsigned long micros() { return nowUs; }
+void delay(unsigned long ms) { FakeClock::advanceMs(ms); }
+
+void FakeClock::reset() { nowUs = 0; }
+void FakeClock::advanceUs(unsigned long us) { nowUs += us; }
+
+struct FakeEventGroup {
+  EventBits_t bits;
+};
+
+struct FakeTask {
+  TaskFunction_t function;
+  void* parameter;
+  uint32_t countNotification;
+  // event group the task waits on, nullptr for its notification
+  FakeEventGroup* waitGroup;
+  EventBits_t waitBits;
+  bool waitsForAllBits;
+};
+
+// Thrown by the waits of a task that would block, to end its run
+struct FakeTaskBlocked {};
+
+static std::vector<std::unique_ptr<FakeTask>> tasks;
+static std::vector<std::unique_ptr<FakeEventGroup>> eventGroups;
+// the test itself when no created task runs
+static FakeTask mainTask = {nullptr, nullptr, 0, nullptr, 0, false};
+static FakeTask* currentTask = &mainTask;
+
+static void runTask(FakeTask* task) {
+  FakeTask* previousTask = currentTask;
+  currentTask = task;
+  try {
+    task->function(task->parameter);
+  } catch (const FakeTaskBlocked&) {
+  }
+  currentTask = previousTask;
+}
+
+static bool isReady(const FakeTask* task) {
+  if (task->waitGroup == nullptr) {
+    return task->countNotification > 0;
+  }
+  EventBits_t bits = task->waitGroup->bits & task->waitBits;
+  return task->waitsForAllBits ? bits == task->waitBits : bits != 0;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char*, uint32_t,
+                       void* parameter, UBaseType_t, TaskHandle_t* pTask) {
+  tasks.emplace_back(
+      new FakeTask{function, parameter, 0, nullptr, 0, false});
+  if (pTask != nullptr) {
+    *pTask = tasks.back().get();
+  }
+  runTask(tasks.back().get());
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return currentTask; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  ++task->countNotification;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks) {
+  uint32_t count = currentTask->countNotification;
+  if (count == 0) {
+    if (ticks == portMAX_DELAY && currentTask != &mainTask) {
+      currentTask->waitGroup = nullptr;
+      throw FakeTaskBlocked();
+    }
+    FakeClock::advanceMs(ticks);
+    return 0;
+  }
+  currentTask->countNotification = clearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+uint32_t ulTaskNotifyValueClear(TaskHandle_t task, uint32_t bitsToClear) {
+  if (task == nullptr) {
+    task = currentTask;
+  }
+  uint32_t value = task->countNotification;
+  task->countNotification &= ~bitsToClear;
+  return value;
+}
+
+void vTaskDelay(TickType_t ticks) { FakeClock::advanceMs(ticks); }
+
+EventGroupHandle_t xEventGroupCreate() {
+  eventGroups.emplace_back(new FakeEventGroup{0});
+  return eventGroups.back().get();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  group->bits |= bits;
+  return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  EventBits_t previous = group->bits;
+  group->bits &= ~bits;
+  return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,
+                                EventBits_t bitsToWaitFor,
+                                BaseType_t clearOnExit,
+                                BaseType_t waitForAllBits, TickType_t ticks) {
+  EventBits_t bits = group->bits;
+  EventBits_t setBits = bits & bitsToWaitFor;
+  if (waitForAllBits ? setBits != bitsToWaitFor : setBits == 0) {
+    if (ticks == portMAX_DELAY && currentTask != &mainTask) {
+      currentTask->waitGroup = group;
+      currentTask->waitBits = bitsToWaitFor;
+      currentTask->waitsForAllBits = waitForAllBits;
+      throw FakeTaskBlocked();
+    }
+    FakeClock::advanceMs(ticks);
+    return bits;
+  }
+  if (clearOnExit) {
+    group->bits &= ~bitsToWaitFor;
+  }
+  return bits;
+}
+
+int FakeTasks::runReady() {
+  int countRun = 0;
+  bool hasRun = true;
+  while (hasRun) {
+    hasRun = false;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      FakeTask* task = tasks[i].get();
+      if (!isReady(task)) {
+        continue;
+      }
+      runTask(task);
+      hasRun = true;
+      ++countRun;
+    }
+  }
+  return countRun;
+}
+
+size_t FakeTasks::getCount() { return tasks.size(); }
+
+void FakeTasks::reset() {
+  tasks.clear();
+  eventGroups.clear();
+  mainTask.countNotification = 0;
+}
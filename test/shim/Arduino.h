@@ -0,0 +1,138 @@
+#pragma once
+
+// Subset of the Arduino core and FreeRTOS used by the library, for host
+// tests. Time only moves with delay() and FakeClock, and tasks run when a
+// test calls FakeTasks::runReady().
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+class String {
+ public:
+  String(const char* str = "") : str(str) {}
+  String(const std::string& str) : str(str) {}
+  explicit String(char c) : str(1, c) {}
+  String(int value) : str(std::to_string(value)) {}
+  String(unsigned value) : str(std::to_string(value)) {}
+  String(long value) : str(std::to_string(value)) {}
+  String(unsigned long value) : str(std::to_string(value)) {}
+  String(bool value) : str(value ? "1" : "0") {}
+
+  const char* c_str() const { return str.c_str(); }
+  unsigned length() const { return str.size(); }
+  bool reserve(unsigned size) {
+    str.reserve(size);
+    return true;
+  }
+
+  bool operator==(const String& other) const { return str == other.str; }
+  bool operator!=(const String& other) const { return str != other.str; }
+  String& operator+=(const String& other) {
+    str += other.str;
+    return *this;
+  }
+  friend String operator+(const String& a, const String& b) {
+    return String(a.str + b.str);
+  }
+  friend String operator+(const String& a, const char* b) {
+    return String(a.str + b);
+  }
+
+ private:
+  std::string str;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    while (size--) count += write(*buffer++);
+    return count;
+  }
+  size_t write(const char* str) {
+    return write((const uint8_t*)str, strlen(str));
+  }
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(const String& str) { return write(str.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return print(String(value)); }
+  size_t print(unsigned value) { return print(String(value)); }
+  size_t print(long value) { return print(String(value)); }
+  size_t print(unsigned long value) { return print(String(value)); }
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    return print(value) + println();
+  }
+  size_t printf(const char* format, ...);
+};
+
+// Prints to stdout
+class HardwareSerial : public Print {
+ public:
+  using Print::write;
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+  int available() { return 0; }
+  int read() { return -1; }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Clock read by millis() and micros()
+namespace FakeClock {
+void reset();
+void advanceUs(unsigned long us);
+inline void advanceMs(unsigned long ms) { advanceUs(ms * 1000); }
+};  // namespace FakeClock
+
+// FreeRTOS
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void (*TaskFunction_t)(void*);
+struct FakeTask;
+typedef FakeTask* TaskHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name,
+                       uint32_t stackSize, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* pTask);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+// Waiting forever with no notification ends the run of the task, see
+// FakeTasks::runReady(). A finite wait advances the clock instead.
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks);
+// Clears the bits of the notification value of the task, or of the calling
+// task for nullptr, and returns the value before
+uint32_t ulTaskNotifyValueClear(TaskHandle_t task, uint32_t bitsToClear);
+void vTaskDelay(TickType_t ticks);
+
+namespace FakeTasks {
+// Runs the created tasks with pending notifications or event bits until all
+// of them wait, and returns how many runs were made. A task also runs once
+// when it is created.
+int runReady();
+// Count of created tasks, deleted by reset() with the event groups
+size_t getCount();
+void reset();
+};  // namespace FakeTasks
@@ -0,0 +1,424 @@
+#include "NimBLEDevice.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+static NimBLEScan scan;
+static std::vector<std::unique_ptr<NimBLEClient>> clients;
+static std::vector<FakePeripheral*> peripherals;
+// kept until reset() like scan results
+static std::vector<std::unique_ptr<NimBLEAdvertisedDevice>> advertisedDevices;
+static uint16_t nextConnId = 0;
+static uint32_t countDeleteBond = 0;
+static uint8_t preferredPhyMask = 0;
+
+int ble_gap_set_prefered_le_phy(uint16_t, uint8_t txPhyMask, uint8_t,
+                                uint16_t) {
+  preferredPhyMask = txPhyMask;
+  return 0;
+}
+
+int ble_gap_read_le_phy(uint16_t, uint8_t* txPhy, uint8_t* rxPhy) {
+  *txPhy = *rxPhy = preferredPhyMask & BLE_GAP_LE_PHY_2M_MASK
+                        ? BLE_GAP_LE_PHY_2M
+                        : BLE_GAP_LE_PHY_1M;
+  return 0;
+}
+
+NimBLEUUID::NimBLEUUID(const std::string& uuid) {
+  for (char c : uuid) {
+    this->uuid += tolower(c);
+  }
+}
+
+NimBLEAddress::NimBLEAddress(const std::string& address, uint8_t type)
+    : address(), type(type) {
+  for (int i = 0; i < 6 && (size_t)i * 3 + 1 < address.size(); ++i) {
+    this->address[5 - i] = strtoul(address.substr(i * 3, 2).c_str(), nullptr,
+                                   16);
+  }
+}
+
+NimBLEAddress::NimBLEAddress(const uint8_t* nativeAddress, uint8_t type)
+    : type(type) {
+  memcpy(address, nativeAddress, sizeof(address));
+}
+
+bool NimBLEAddress::equals(const NimBLEAddress& other) const {
+  return memcmp(address, other.address, sizeof(address)) == 0;
+}
+
+std::string NimBLEAddress::toString() const {
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x", address[5],
+           address[4], address[3], address[2], address[1], address[0]);
+  return buf;
+}
+
+std::string NimBLERemoteCharacteristic::readValue() {
+  ++countRead;
+  if (!pService->pPeripheral->waitForEvent()) {
+    return "";
+  }
+  return value;
+}
+
+bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data,
+                                            size_t length, bool) {
+  if (getRemoteService()->getClient() == nullptr) {
+    return false;
+  }
+  writtenValue.assign(data, data + length);
+  ++countWrite;
+  return true;
+}
+
+NimBLERemoteDescriptor* NimBLERemoteCharacteristic::getDescriptor(
+    const NimBLEUUID& uuid) {
+  if (getRemoteService()->getClient() == nullptr) {
+    return nullptr;
+  }
+  for (auto& pDesc : descriptors) {
+    if (pDesc->getUUID().equals(uuid)) {
+      return pDesc.get();
+    }
+  }
+  return nullptr;
+}
+
+NimBLERemoteDescriptor* NimBLERemoteCharacteristic::addDescriptor(
+    const NimBLEUUID& uuid, const std::string& value) {
+  descriptors.emplace_back(new NimBLERemoteDescriptor(this, uuid));
+  descriptors.back()->value = value;
+  return descriptors.back().get();
+}
+
+std::string NimBLERemoteDescriptor::readValue() {
+  ++countRead;
+  if (!pChara->getRemoteService()->pPeripheral->waitForEvent()) {
+    return "";
+  }
+  return value;
+}
+
+bool NimBLERemoteCharacteristic::subscribe(bool, notify_callback callback,
+                                           bool) {
+  if (!canNotify() || getRemoteService()->getClient() == nullptr) {
+    return false;
+  }
+  this->callback = callback;
+  return true;
+}
+
+std::vector<NimBLERemoteCharacteristic*>*
+NimBLERemoteService::getCharacteristics(bool refresh) {
+  if (refresh && getClient() != nullptr) {
+    discovered.clear();
+    for (auto& pChara : characteristics) {
+      discovered.push_back(pChara.get());
+    }
+    ++pPeripheral->countDiscovery;
+  }
+  return &discovered;
+}
+
+NimBLEClient* NimBLERemoteService::getClient() {
+  return pPeripheral->pClient;
+}
+
+bool NimBLEClient::connect(const NimBLEAddress& address,
+                           bool deleteAttributes) {
+  if (isConnected()) {
+    return false;
+  }
+  peerAddress = address;
+  ++countConnect;
+  FakePeripheral* pFound = nullptr;
+  for (auto pPeripheral : peripherals) {
+    if (pPeripheral->address.equals(address)) {
+      pFound = pPeripheral;
+    }
+  }
+  if (pFound == nullptr || !pFound->isConnectable ||
+      pFound->pClient != nullptr) {
+    delay(connectTimeoutSec * 1000);
+    return false;
+  }
+  if (pFound->countFailingConnect > 0) {
+    --pFound->countFailingConnect;
+    delay(connectTimeoutSec * 1000);
+    return false;
+  }
+  if (!pFound->waitForEvent()) {
+    return false;
+  }
+  if (deleteAttributes) {
+    pFound->forgetDiscovery();
+  }
+  pPeripheral = pFound;
+  pFound->pClient = this;
+  if (pCallbacks != nullptr) {
+    pCallbacks->onConnect(this);
+  }
+  return true;
+}
+
+int NimBLEClient::disconnect(uint8_t) {
+  if (pPeripheral != nullptr) {
+    pPeripheral->disconnect();
+  }
+  return 0;
+}
+
+NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
+  return isConnected() ? pPeripheral->getService(uuid) : nullptr;
+}
+
+void NimBLEClient::setConnectionParams(uint16_t minInterval, uint16_t,
+                                       uint16_t latency, uint16_t timeout,
+                                       uint16_t, uint16_t) {
+  // the peripheral accepts the shortest interval
+  connInfo.interval = minInterval;
+  connInfo.latency = latency;
+  connInfo.timeout = timeout;
+}
+
+const uint8_t* NimBLEAdvertisedDevice::findField(uint8_t type,
+                                                 uint8_t* pLength) {
+  size_t i = 0;
+  while (i + 1 < payload.size() && payload[i] != 0) {
+    uint8_t len = payload[i];
+    if (i + 1 + len > payload.size()) {
+      break;
+    }
+    if (payload[i + 1] == type) {
+      *pLength = len - 1;
+      return &payload[i + 2];
+    }
+    i += 1 + len;
+  }
+  return nullptr;
+}
+
+NimBLEUUID NimBLEAdvertisedDevice::getServiceUUID(uint8_t index) {
+  uint8_t len;
+  const uint8_t* pData = findField(0x03, &len);
+  if (pData == nullptr) {
+    pData = findField(0x02, &len);
+  }
+  if (pData == nullptr || (index + 1) * 2 > len) {
+    return NimBLEUUID();
+  }
+  char buf[5];
+  snprintf(buf, sizeof(buf), "%04x",
+           pData[index * 2] | pData[index * 2 + 1] << 8);
+  return NimBLEUUID(buf);
+}
+
+bool NimBLEScan::start(uint32_t, void (*scanCompleteCB)(NimBLEScanResults),
+                       bool) {
+  this->scanCompleteCB = scanCompleteCB;
+  isRunning = true;
+  ++countStart;
+  return true;
+}
+
+bool NimBLEScan::stop() {
+  if (!isRunning) {
+    return true;
+  }
+  isRunning = false;
+  if (scanCompleteCB != nullptr) {
+    scanCompleteCB(NimBLEScanResults());
+  }
+  return true;
+}
+
+NimBLEScan* NimBLEDevice::getScan() { return &scan; }
+
+NimBLEClient* NimBLEDevice::createClient() {
+  if (clients.size() >= NIMBLE_MAX_CONNECTIONS) {
+    return nullptr;
+  }
+  clients.emplace_back(new NimBLEClient(nextConnId++));
+  return clients.back().get();
+}
+
+size_t NimBLEDevice::getClientListSize() { return clients.size(); }
+
+NimBLEClient* NimBLEDevice::getClientByPeerAddress(
+    const NimBLEAddress& address) {
+  for (auto& pClient : clients) {
+    if (pClient->getPeerAddress().equals(address)) {
+      return pClient.get();
+    }
+  }
+  return nullptr;
+}
+
+NimBLEClient* NimBLEDevice::getClientByID(uint16_t connId) {
+  for (auto& pClient : clients) {
+    if (pClient->getConnId() == connId) {
+      return pClient.get();
+    }
+  }
+  return nullptr;
+}
+
+bool NimBLEDevice::deleteBond(const NimBLEAddress&) {
+  ++countDeleteBond;
+  return true;
+}
+
+FakePeripheral::~FakePeripheral() {
+  if (pClient != nullptr) {
+    pClient->pPeripheral = nullptr;
+  }
+  for (size_t i = 0; i < peripherals.size(); ++i) {
+    if (peripherals[i] == this) {
+      peripherals.erase(peripherals.begin() + i);
+      break;
+    }
+  }
+}
+
+void FakePeripheral::setXboxAdvertisement() {
+  advertisement = {
+      0x02, 0x01, 0x06,              // flags
+      0x03, 0x19, 0xc4, 0x03,        // appearance 964 (gamepad)
+      0x03, 0x03, 0x12, 0x18,        // HID service
+      0x04, 0xff, 0x06, 0x00, 0x00,  // manufacturer data
+  };
+}
+
+NimBLERemoteCharacteristic* FakePeripheral::addCharacteristic(
+    const NimBLEUUID& uuidService, const NimBLEUUID& uuidChara,
+    uint16_t handle, uint8_t properties, const std::string& value) {
+  NimBLERemoteService* pService = getService(uuidService);
+  if (pService == nullptr) {
+    services.emplace_back(new NimBLERemoteService(this, uuidService));
+    pService = services.back().get();
+  }
+  auto& characteristics = pService->characteristics;
+  size_t i = 0;
+  while (i < characteristics.size() &&
+         characteristics[i]->getHandle() < handle) {
+    ++i;
+  }
+  NimBLERemoteCharacteristic* pChara =
+      new NimBLERemoteCharacteristic(pService, uuidChara, handle, properties);
+  characteristics.emplace(characteristics.begin() + i, pChara);
+  pChara->value = value;
+  return pChara;
+}
+
+bool FakePeripheral::notify(NimBLERemoteCharacteristic* pChara,
+                            const uint8_t* data, size_t length) {
+  if (pClient == nullptr || !pChara->callback) {
+    return false;
+  }
+  // NimBLE passes a buffer of its own
+  std::vector<uint8_t> buf(data, data + length);
+  pChara->callback(pChara, buf.data(), buf.size(), true);
+  return true;
+}
+
+void FakePeripheral::disconnect() {
+  NimBLEClient* pDisconnected = pClient;
+  if (pDisconnected == nullptr) {
+    return;
+  }
+  pClient = nullptr;
+  pDisconnected->pPeripheral = nullptr;
+  unsubscribeAll();
+  if (pDisconnected->pCallbacks != nullptr) {
+    pDisconnected->pCallbacks->onDisconnect(pDisconnected);
+  }
+}
+
+NimBLERemoteService* FakePeripheral::getService(const NimBLEUUID& uuid) {
+  for (auto& pService : services) {
+    if (pService->getUUID().equals(uuid)) {
+      return pService.get();
+    }
+  }
+  return nullptr;
+}
+
+void FakePeripheral::reset() {
+  if (pClient != nullptr) {
+    pClient->pPeripheral = nullptr;
+    pClient = nullptr;
+  }
+  unsubscribeAll();
+  forgetDiscovery();
+}
+
+bool FakePeripheral::waitForEvent() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  ulTaskNotifyValueClear(task, 0xffffffff);
+  if (onWait) {
+    onWait();
+  }
+  if (ulTaskNotifyTake(pdTRUE, 0) > 0) {
+    ++countEarlyWake;
+    return false;
+  }
+  // the event handler of NimBLE notifies the task
+  xTaskNotifyGive(task);
+  return ulTaskNotifyTake(pdTRUE, portMAX_DELAY) > 0;
+}
+
+void FakePeripheral::forgetDiscovery() {
+  for (auto& pService : services) {
+    pService->discovered.clear();
+  }
+}
+
+void FakePeripheral::unsubscribeAll() {
+  for (auto& pService : services) {
+    for (auto& pChara : pService->characteristics) {
+      pChara->callback = nullptr;
+    }
+  }
+}
+
+void FakeNimBLE::reset() {
+  for (auto pPeripheral : peripherals) {
+    pPeripheral->reset();
+  }
+  peripherals.clear();
+  clients.clear();
+  advertisedDevices.clear();
+  scan = NimBLEScan();
+  nextConnId = 0;
+  countDeleteBond = 0;
+  preferredPhyMask = 0;
+}
+
+void FakeNimBLE::addPeripheral(FakePeripheral& peripheral) {
+  peripherals.push_back(&peripheral);
+}
+
+bool FakeNimBLE::advertise(FakePeripheral& peripheral) {
+  if (!scan.isScanning()) {
+    return false;
+  }
+  return advertiseLate(peripheral);
+}
+
+bool FakeNimBLE::advertiseLate(FakePeripheral& peripheral) {
+  if (scan.getCallbacks() == nullptr) {
+    return false;
+  }
+  advertisedDevices.emplace_back(new NimBLEAdvertisedDevice(
+      peripheral.address, peripheral.advertisement));
+  scan.getCallbacks()->onResult(advertisedDevices.back().get());
+  return true;
+}
+
+void FakeNimBLE::endScan() { scan.stop(); }
+
+uint32_t FakeNimBLE::getCountDeleteBond() { return countDeleteBond; }
+
+uint8_t FakeNimBLE::getPreferredPhyMask() { return preferredPhyMask; }
@@ -0,0 +1,393 @@
+#pragma once
+
+// Fake of the NimBLE-Arduino 1.x client API used by the library, for host
+// tests. FakePeripheral holds the advertisement and the GATT table of a
+// controller in range, and FakeNimBLE injects advertisements into a running
+// scan. Connections, discovery and subscriptions complete synchronously.
+// Connections and reads still wait on the task notification like NimBLE.
+
+#include <Arduino.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define NIMBLE_MAX_CONNECTIONS 3
+#define CONFIG_BTDM_SCAN_DUPL_TYPE_DEVICE 0
+#define BLE_OWN_ADDR_PUBLIC 0
+#define ESP_PWR_LVL_P9 7
+#define BLE_GAP_LE_PHY_1M 1
+#define BLE_GAP_LE_PHY_2M 2
+#define BLE_GAP_LE_PHY_1M_MASK 0x01
+#define BLE_GAP_LE_PHY_2M_MASK 0x02
+#define BLE_GAP_LE_PHY_CODED_ANY 0
+
+struct ble_gap_sec_state {
+  unsigned encrypted : 1;
+};
+struct ble_gap_conn_desc {
+  uint16_t conn_handle;
+  ble_gap_sec_state sec_state;
+};
+
+int ble_gap_set_prefered_le_phy(uint16_t connHandle, uint8_t txPhyMask,
+                                uint8_t rxPhyMask, uint16_t phyOptions);
+int ble_gap_read_le_phy(uint16_t connHandle, uint8_t* txPhy, uint8_t* rxPhy);
+
+class NimBLEUUID {
+ public:
+  NimBLEUUID() {}
+  NimBLEUUID(const std::string& uuid);
+  NimBLEUUID(const char* uuid) : NimBLEUUID(std::string(uuid)) {}
+  bool equals(const NimBLEUUID& other) const { return uuid == other.uuid; }
+  bool operator==(const NimBLEUUID& other) const { return equals(other); }
+  std::string toString() const { return uuid; }
+  operator std::string() const { return uuid; }
+
+ private:
+  std::string uuid;
+};
+
+class NimBLEAddress {
+ public:
+  NimBLEAddress() : address(), type(0) {}
+  // "44:16:22:aa:bb:cc"
+  NimBLEAddress(const std::string& address, uint8_t type = 0);
+  NimBLEAddress(const uint8_t* nativeAddress, uint8_t type = 0);
+  // reversed from the printed order like NimBLE
+  const uint8_t* getNative() const { return address; }
+  uint8_t getType() const { return type; }
+  bool equals(const NimBLEAddress& other) const;
+  bool operator==(const NimBLEAddress& other) const { return equals(other); }
+  std::string toString() const;
+  operator std::string() const { return toString(); }
+
+ private:
+  uint8_t address[6];
+  uint8_t type;
+};
+
+class NimBLEClient;
+class NimBLERemoteCharacteristic;
+class NimBLERemoteService;
+class FakePeripheral;
+
+namespace FakeProperty {
+enum : uint8_t {
+  Read = 0x02,
+  WriteNoResponse = 0x04,
+  Write = 0x08,
+  Notify = 0x10,
+};
+};  // namespace FakeProperty
+
+class NimBLERemoteDescriptor {
+ public:
+  NimBLERemoteDescriptor(NimBLERemoteCharacteristic* pChara,
+                         const NimBLEUUID& uuid)
+      : pChara(pChara), uuid(uuid) {}
+
+  NimBLEUUID getUUID() { return uuid; }
+  NimBLERemoteCharacteristic* getRemoteCharacteristic() { return pChara; }
+  std::string readValue();
+
+  // Fake side
+  std::string value;
+  uint32_t countRead = 0;
+
+ private:
+  NimBLERemoteCharacteristic* pChara;
+  NimBLEUUID uuid;
+};
+
+class NimBLERemoteCharacteristic {
+ public:
+  typedef std::function<void(NimBLERemoteCharacteristic*, uint8_t*, size_t,
+                             bool)>
+      notify_callback;
+
+  NimBLERemoteCharacteristic(NimBLERemoteService* pService,
+                             const NimBLEUUID& uuid, uint16_t handle,
+                             uint8_t properties)
+      : pService(pService), uuid(uuid), handle(handle),
+        properties(properties) {}
+
+  bool canRead() { return properties & FakeProperty::Read; }
+  bool canWrite() { return properties & FakeProperty::Write; }
+  bool canWriteNoResponse() {
+    return properties & FakeProperty::WriteNoResponse;
+  }
+  bool canNotify() { return properties & FakeProperty::Notify; }
+  std::string readValue();
+  bool writeValue(const uint8_t* data, size_t length, bool response = false);
+  bool subscribe(bool notifications = true, notify_callback callback = nullptr,
+                 bool response = false);
+  NimBLERemoteDescriptor* getDescriptor(const NimBLEUUID& uuid);
+  NimBLERemoteService* getRemoteService() { return pService; }
+  NimBLEUUID getUUID() { return uuid; }
+  uint16_t getHandle() { return handle; }
+  std::string toString() { return "Characteristic: " + uuid.toString(); }
+
+  // Fake side
+  std::string value;
+  std::vector<uint8_t> writtenValue;
+  uint32_t countWrite = 0;
+  uint32_t countRead = 0;
+  bool isSubscribed() const { return callback != nullptr; }
+  NimBLERemoteDescriptor* addDescriptor(const NimBLEUUID& uuid,
+                                        const std::string& value);
+
+ private:
+  friend class FakePeripheral;
+  NimBLERemoteService* pService;
+  NimBLEUUID uuid;
+  uint16_t handle;
+  uint8_t properties;
+  notify_callback callback;
+  std::vector<std::unique_ptr<NimBLERemoteDescriptor>> descriptors;
+};
+
+class NimBLERemoteService {
+ public:
+  NimBLERemoteService(FakePeripheral* pPeripheral, const NimBLEUUID& uuid)
+      : pPeripheral(pPeripheral), uuid(uuid) {}
+
+  NimBLEUUID getUUID() { return uuid; }
+  // refresh discovers the characteristics, otherwise the ones discovered
+  // before are returned
+  std::vector<NimBLERemoteCharacteristic*>* getCharacteristics(
+      bool refresh = false);
+  NimBLEClient* getClient();
+  std::string toString() { return "Service: " + uuid.toString(); }
+
+ private:
+  friend class FakePeripheral;
+  friend class NimBLERemoteCharacteristic;
+  friend class NimBLERemoteDescriptor;
+  FakePeripheral* pPeripheral;
+  NimBLEUUID uuid;
+  std::vector<std::unique_ptr<NimBLERemoteCharacteristic>> characteristics;
+  std::vector<NimBLERemoteCharacteristic*> discovered;
+};
+
+class NimBLEConnInfo {
+ public:
+  uint16_t getConnInterval() { return interval; }
+  uint16_t getConnLatency() { return latency; }
+  uint16_t getConnTimeout() { return timeout; }
+
+  uint16_t interval = 0;
+  uint16_t latency = 0;
+  uint16_t timeout = 0;
+};
+
+class NimBLEClientCallbacks {
+ public:
+  virtual ~NimBLEClientCallbacks() {}
+  virtual void onConnect(NimBLEClient*) {}
+  virtual void onDisconnect(NimBLEClient*) {}
+  virtual uint32_t onPassKeyRequest() { return 0; }
+  virtual bool onConfirmPIN(uint32_t) { return true; }
+  virtual void onAuthenticationComplete(ble_gap_conn_desc*) {}
+};
+
+class NimBLEClient {
+ public:
+  bool connect(bool deleteAttributes = true) {
+    return connect(peerAddress, deleteAttributes);
+  }
+  bool connect(const NimBLEAddress& address, bool deleteAttributes = true);
+  int disconnect(uint8_t reason = 0x13);
+  bool isConnected() { return pPeripheral != nullptr; }
+  NimBLEAddress getPeerAddress() { return peerAddress; }
+  int getRssi() { return -50; }
+  uint16_t getConnId() { return connId; }
+  NimBLEConnInfo getConnInfo() { return connInfo; }
+  NimBLERemoteService* getService(const NimBLEUUID& uuid);
+  void setClientCallbacks(NimBLEClientCallbacks* pCallbacks, bool = true) {
+    this->pCallbacks = pCallbacks;
+  }
+  void setConnectionParams(uint16_t minInterval, uint16_t maxInterval,
+                           uint16_t latency, uint16_t timeout,
+                           uint16_t scanInterval = 16,
+                           uint16_t scanWindow = 16);
+  void updateConnParams(uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout) {
+    setConnectionParams(minInterval, maxInterval, latency, timeout);
+  }
+  void setDataLen(uint16_t dataLen) { this->dataLen = dataLen; }
+  void setConnectTimeout(uint32_t timeoutSec) {
+    connectTimeoutSec = timeoutSec;
+  }
+  std::string toString() { return "Client: " + peerAddress.toString(); }
+
+  // Fake side
+  NimBLEClientCallbacks* getClientCallbacks() { return pCallbacks; }
+  uint32_t getConnectTimeoutSec() { return connectTimeoutSec; }
+  uint16_t getDataLen() { return dataLen; }
+  uint32_t getCountConnect() { return countConnect; }
+
+ private:
+  friend class FakePeripheral;
+  friend class NimBLEDevice;
+  explicit NimBLEClient(uint16_t connId) : connId(connId) {}
+
+  uint16_t connId;
+  NimBLEAddress peerAddress;
+  FakePeripheral* pPeripheral = nullptr;
+  NimBLEClientCallbacks* pCallbacks = nullptr;
+  NimBLEConnInfo connInfo;
+  uint32_t connectTimeoutSec = 30;
+  uint16_t dataLen = 27;
+  uint32_t countConnect = 0;
+};
+
+class NimBLEAdvertisedDevice {
+ public:
+  NimBLEAdvertisedDevice(const NimBLEAddress& address,
+                         const std::vector<uint8_t>& payload)
+      : address(address), payload(payload) {}
+
+  NimBLEAddress getAddress() { return address; }
+  std::string getName() { return ""; }
+  bool haveServiceUUID() { return getServiceUUID().toString() != ""; }
+  // 16-bit service UUIDs only
+  NimBLEUUID getServiceUUID(uint8_t index = 0);
+  uint8_t* getPayload() { return payload.data(); }
+  size_t getPayloadLength() { return payload.size(); }
+  std::string toString() { return "Advertised Device: " + address.toString(); }
+
+ private:
+  NimBLEAddress address;
+  std::vector<uint8_t> payload;
+
+  // Data of the first AD structure of the type, or nullptr
+  const uint8_t* findField(uint8_t type, uint8_t* pLength);
+};
+
+class NimBLEAdvertisedDeviceCallbacks {
+ public:
+  virtual ~NimBLEAdvertisedDeviceCallbacks() {}
+  virtual void onResult(NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+class NimBLEScanResults {};
+
+class NimBLEScan {
+ public:
+  void setDuplicateFilter(bool) {}
+  void setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks* pCallbacks,
+                                    bool = false) {
+    this->pCallbacks = pCallbacks;
+  }
+  void setInterval(uint16_t) {}
+  void setWindow(uint16_t) {}
+  void setActiveScan(bool) {}
+  bool start(uint32_t duration, void (*scanCompleteCB)(NimBLEScanResults),
+             bool isContinue = false);
+  bool stop();
+  bool isScanning() { return isRunning; }
+  void clearResults() {}
+
+  // Fake side
+  NimBLEAdvertisedDeviceCallbacks* getCallbacks() { return pCallbacks; }
+  uint32_t getCountStart() { return countStart; }
+
+ private:
+  friend class NimBLEDevice;
+  NimBLEAdvertisedDeviceCallbacks* pCallbacks = nullptr;
+  void (*scanCompleteCB)(NimBLEScanResults) = nullptr;
+  bool isRunning = false;
+  uint32_t countStart = 0;
+};
+
+class NimBLEDevice {
+ public:
+  static void init(const std::string&) {}
+  static void setScanFilterMode(uint8_t) {}
+  static void setOwnAddrType(uint8_t, bool = false) {}
+  static void setSecurityAuth(bool, bool, bool) {}
+  static void setPower(int) {}
+  static NimBLEScan* getScan();
+  static NimBLEClient* createClient();
+  static size_t getClientListSize();
+  static NimBLEClient* getClientByPeerAddress(const NimBLEAddress& address);
+  static NimBLEClient* getClientByID(uint16_t connId);
+  static bool deleteBond(const NimBLEAddress& address);
+};
+
+// A device in range of the fake radio
+class FakePeripheral {
+ public:
+  explicit FakePeripheral(const std::string& address) : address(address) {}
+  ~FakePeripheral();
+
+  NimBLEAddress address;
+  // raw advertisement payload, see setXboxAdvertisement()
+  std::vector<uint8_t> advertisement;
+  bool isConnectable = true;
+  // connect() fails this many times before the next success
+  int countFailingConnect = 0;
+  // Called while a connection or a read of this peripheral waits for the
+  // event, as other code running in the meantime. A notification of the
+  // waiting task given there wakes the wait early, which then fails.
+  std::function<void()> onWait;
+
+  // Advertisement of an xbox controller: gamepad appearance, HID service
+  // and the manufacturer data of a bonded controller
+  void setXboxAdvertisement();
+
+  // Discovered in the order of their handles like NimBLE
+  NimBLERemoteCharacteristic* addCharacteristic(const NimBLEUUID& uuidService,
+                                                const NimBLEUUID& uuidChara,
+                                                uint16_t handle,
+                                                uint8_t properties,
+                                                const std::string& value = "");
+
+  // Calls the subscribed callback, returns false when not subscribed
+  bool notify(NimBLERemoteCharacteristic* pChara, const uint8_t* data,
+              size_t length);
+  // Link lost, the client callbacks see onDisconnect()
+  void disconnect();
+
+  // Back to the state before any connection
+  void reset();
+
+  NimBLEClient* getClient() { return pClient; }
+  NimBLERemoteService* getService(const NimBLEUUID& uuid);
+  uint32_t getCountDiscovery() { return countDiscovery; }
+  uint32_t getCountEarlyWake() { return countEarlyWake; }
+
+ private:
+  friend class NimBLEClient;
+  friend class NimBLERemoteCharacteristic;
+  friend class NimBLERemoteDescriptor;
+  friend class NimBLERemoteService;
+  std::vector<std::unique_ptr<NimBLERemoteService>> services;
+  NimBLEClient* pClient = nullptr;
+  uint32_t countDiscovery = 0;
+  uint32_t countEarlyWake = 0;
+
+  // Returns false when the wait was woken by another notification
+  bool waitForEvent();
+  void forgetDiscovery();
+  void unsubscribeAll();
+};
+
+namespace FakeNimBLE {
+// Deletes the clients and forgets peripherals, scan and bonds
+void reset();
+// The peripheral has to stay alive until reset()
+void addPeripheral(FakePeripheral& peripheral);
+// Passes the advertisement to the scan callbacks while scanning, and
+// returns whether it was passed
+bool advertise(FakePeripheral& peripheral);
+// Passes the advertisement to the scan callbacks after the scan stopped,
+// like a result NimBLE reports late
+bool advertiseLate(FakePeripheral& peripheral);
+// The scan duration elapsed
+void endScan();
+uint32_t getCountDeleteBond();
+uint8_t getPreferredPhyMask();
+};  // namespace FakeNimBLE
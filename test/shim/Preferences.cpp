@@ -0,0 +1,60 @@
+#include "Preferences.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+static std::map<std::string, std::vector<uint8_t>> entries;
+static uint32_t countPut = 0;
+
+static std::string toEntryKey(const char* name, const char* key) {
+  return std::string(name) + "/" + key;
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  this->name = name;
+  this->readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() { name = nullptr; }
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  if (name == nullptr) {
+    return 0;
+  }
+  auto entry = entries.find(toEntryKey(name, key));
+  if (entry == entries.end() || entry->second.size() > maxLen) {
+    return 0;
+  }
+  memcpy(buf, entry->second.data(), entry->second.size());
+  return entry->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (name == nullptr || readOnly) {
+    return 0;
+  }
+  const uint8_t* bytes = (const uint8_t*)value;
+  entries[toEntryKey(name, key)].assign(bytes, bytes + len);
+  ++countPut;
+  return len;
+}
+
+bool Preferences::remove(const char* key) {
+  return name != nullptr && !readOnly &&
+         entries.erase(toEntryKey(name, key)) != 0;
+}
+
+void FakePreferences::reset() {
+  entries.clear();
+  countPut = 0;
+}
+
+bool FakePreferences::has(const char* name, const char* key) {
+  return entries.count(toEntryKey(name, key)) != 0;
+}
+
+uint32_t FakePreferences::getCountPut() { return countPut; }
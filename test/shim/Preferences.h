@@ -0,0 +1,26 @@
+#pragma once
+
+// NVS of the ESP32 Arduino core kept in memory for host tests
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t putBytes(const char* key, const void* value, size_t len);
+  bool remove(const char* key);
+
+ private:
+  const char* name = nullptr;
+  bool readOnly = false;
+};
+
+namespace FakePreferences {
+void reset();
+bool has(const char* name, const char* key);
+// Writes by putBytes() since reset()
+uint32_t getCountPut();
+};  // namespace FakePreferences
@@ -0,0 +1,22 @@
+#pragma once
+
+// FreeRTOS event groups for host tests, run by FakeTasks like the task
+// notifications in Arduino.h
+
+#include <Arduino.h>
+
+typedef uint32_t EventBits_t;
+struct FakeEventGroup;
+typedef FakeEventGroup* EventGroupHandle_t;
+
+// Deleted by FakeTasks::reset()
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+// Waiting forever for bits that are not set ends the run of the task, see
+// FakeTasks::runReady(). A finite wait advances the clock instead.
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,
+                                EventBits_t bitsToWaitFor,
+                                BaseType_t clearOnExit,
+                                BaseType_t waitForAllBits, TickType_t ticks);